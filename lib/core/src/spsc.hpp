@@ -0,0 +1,147 @@
+/*
+ * spsc.hpp
+ *
+ * Lock-free single producer / single consumer queue.
+ *
+ * Created: 10/16/2026
+ *  Author: uliano
+ */
+
+#pragma once
+
+#include "utils.hpp"
+#include <stdint.h>
+
+/**
+ * @brief Lock-free SPSC queue for ISR -> main loop hand-off
+ *
+ * @tparam T Element type stored in the queue
+ * @tparam queue_size Queue size - MUST be a power of 2 and <= 256
+ *
+ * Unlike Ring, this queue never disables interrupts and never overwrites:
+ * - m_head is written only by the producer (ISR)
+ * - m_tail is written only by the consumer (main loop)
+ * - both indices are uint8_t, so every read/write is a single atomic access
+ *   on the 8-bit AVR and no ATOMIC_BLOCK is needed on either side.
+ *
+ * A compiler barrier orders the element copy against the index publication,
+ * so the consumer never sees an index that points to a half-written element.
+ *
+ * When the queue is full, push() fails and the element is dropped: the caller
+ * decides how to account for it.
+ *
+ * Usage example:
+ *   SpscQueue<Record, 16> queue;
+ *
+ *   // In ISR:
+ *   if (!queue.push(record)) { ++lost; }
+ *
+ *   // In main loop (batch drain):
+ *   uint8_t n = queue.available();
+ *   for (uint8_t i = 0; i < n; ++i) {
+ *       process(queue.peek(i));
+ *   }
+ *   queue.consume(n);
+ *
+ * Important notes:
+ * - The queue can hold (queue_size - 1) elements
+ * - Only ONE producer and ONE consumer context are allowed
+ */
+template <typename T, int queue_size>
+class SpscQueue {
+    static_assert(is_powerof2(queue_size), "spsc queue size should be power of 2");
+    static_assert(queue_size <= 256, "spsc queue indices are uint8_t, size should be <= 256");
+
+private:
+    static constexpr uint8_t mask = static_cast<uint8_t>(queue_size - 1);
+
+    T data[queue_size]{};          // Element storage
+    volatile uint8_t m_head{0};    // Next slot to write (producer owned)
+    volatile uint8_t m_tail{0};    // Next slot to read (consumer owned)
+
+    static inline void barrier() {
+        __asm__ __volatile__("" ::: "memory");
+    }
+
+public:
+    static constexpr uint8_t capacity() {
+        return static_cast<uint8_t>(queue_size - 1);
+    }
+
+    /**
+     * @brief Producer side: append an element
+     *
+     * @return false if the queue is full (element not stored)
+     */
+    inline bool push(const T &value) {
+        const uint8_t head = m_head;
+        const uint8_t next = static_cast<uint8_t>((head + 1u) & mask);
+        if (next == m_tail) {
+            return false;
+        }
+        data[head] = value;
+        barrier();
+        m_head = next;
+        return true;
+    }
+
+    // Producer side: number of free slots.
+    inline uint8_t free_from_producer() const {
+        return static_cast<uint8_t>(capacity() - ((m_head - m_tail) & mask));
+    }
+
+    /**
+     * @brief Consumer side: number of elements ready to be read
+     *
+     * The value can only grow until the consumer calls consume()/pop().
+     */
+    inline uint8_t available() const {
+        const uint8_t count = static_cast<uint8_t>((m_head - m_tail) & mask);
+        barrier();
+        return count;
+    }
+
+    inline bool empty() const {
+        return available() == 0;
+    }
+
+    /**
+     * @brief Consumer side: access the i-th oldest element without removing it
+     *
+     * @note i must be < available()
+     */
+    inline const T &peek(uint8_t i) const {
+        return data[(m_tail + i) & mask];
+    }
+
+    /**
+     * @brief Consumer side: release n elements previously inspected with peek()
+     *
+     * @note n must be <= available()
+     */
+    inline void consume(uint8_t n) {
+        barrier();
+        m_tail = static_cast<uint8_t>((m_tail + n) & mask);
+    }
+
+    /**
+     * @brief Consumer side: retrieve and remove the oldest element
+     *
+     * @return false if the queue was empty
+     */
+    inline bool pop(T &out_value) {
+        if (!available()) {
+            return false;
+        }
+        out_value = peek(0);
+        consume(1);
+        return true;
+    }
+
+    /**
+     * @brief Consumer side: drop everything currently queued
+     */
+    inline void flush() {
+        consume(available());
+    }
+};
@@ -62,8 +62,10 @@ class Uart : public ByteStream {
 	Ring<uint8_t, RSizeT, rsize> m_input_buffer;
 	Ring<uint8_t, TSizeT, tsize> m_output_buffer;
 
-	// Error counters (volatile uint8_t for atomic ISR access, wrap at 255).
-	volatile uint8_t m_tx_errors;
+	// RX overruns are counted by the ISR (volatile uint8_t for atomic access,
+	// wraps at 255). TX drops are counted by write_byte(), which runs in the
+	// main loop only, so the counter can be wide and never wraps in practice.
+	uint32_t m_tx_errors;
 	volatile uint8_t m_rx_errors;
 
 	public:
@@ -207,7 +209,7 @@ class Uart : public ByteStream {
         return read_byte(*b);
     }
 
-	inline uint8_t tx_errors(void) const {
+	inline uint32_t tx_errors(void) const {
 		return m_tx_errors;
 	}
 
@@ -226,7 +228,7 @@ class Uart : public ByteStream {
 
     bool write_byte(uint8_t b) override {
 		if (!m_output_buffer.try_put(b)) {
-			++m_tx_errors;  // Atomic - uint8_t on 8-bit AVR
+			++m_tx_errors;
 			return false;
 		}
 		regs->CTRLA |= USART_DREIE_bm;
@@ -0,0 +1,382 @@
+/*
+ * acquisition.hpp
+ *
+ * ISR -> superloop hand-off of complete integration windows.
+ *
+ * Created: 10/16/2026
+ *  Author: uliano
+ */
+
+#pragma once
+#include <stdint.h>
+#include <util/atomic.h>
+#include <spsc.hpp>
+#include "input_source.h"
+
+/*
+ * One complete integration window as assembled by the interrupts.
+ *
+ * negative_counts is the number of negative reference cycles inside the window,
+ * period the total number of heartbeat cycles in it, residue the raw ADC0
+ * reading of the integrator at window end and residue_delta the difference
+ * with the reading at the end of the previous window.
+ */
+struct WindowRecord {
+    uint32_t negative_counts;
+    uint32_t period;
+    int16_t residue;
+    int16_t residue_delta;
+    uint32_t index;          // window sequence number since the last restart
+    uint8_t flags;           // RECORD_* bits
+};
+
+constexpr uint8_t RECORD_AUTOZERO = 0x01;  // window of an autozero sequence
+constexpr uint8_t RECORD_ZERO = 0x02;      // the window read REF0 as a zero
+constexpr uint8_t RECORD_DRIFT_ZERO = 0x04; // window stolen for drift tracking, REF0
+constexpr uint8_t RECORD_DRIFT_SPAN = 0x08; // window stolen for drift tracking, span reference
+constexpr uint8_t RECORD_DRIFT = RECORD_DRIFT_ZERO | RECORD_DRIFT_SPAN;
+
+/*
+ * One window of a burst, as stored by the window end ISRs: the period is the
+ * same for the whole burst and at most 65535, so is the negative count.
+ */
+struct BurstSample {
+    uint16_t negative_counts;
+    int16_t residue_delta;
+};
+
+constexpr uint16_t BURST_MAX_WINDOWS = 512;  // 2 KiB of SRAM
+
+/*
+ * How the counters behave across trigger, input change and end of a run.
+ *
+ * RESTART:      counters are reset (and stopped at the end of a run): the first
+ *               window is aligned to the command but one window is spent priming.
+ * FREE_RUNNING: counters are started once and never reset or stopped, every
+ *               window is the modular difference of consecutive snapshots and
+ *               a command only drops the window in progress.
+ */
+enum class CountingMode : uint8_t {
+    RESTART = 0,
+    FREE_RUNNING = 1
+};
+
+/*
+ * Window assembly and lock-free record queue
+ *
+ * The window end event (TCB3 CAPT, channel 1) both fires TCB3_INT and starts
+ * the ADC conversion, so every window produces two halves:
+ *   - window_complete_from_isr(): negative counter snapshot and window
+ *                                 period (TCB3 ISR)
+ *   - residue_ready_from_isr():   integrator residue (ADC0 RESRDY ISR)
+ * whichever arrives second completes the record and pushes it to the queue.
+ * The ISRs never wait for the superloop: if the superloop falls more than
+ * queue_depth windows behind, the newest records are dropped and counted
+ * in lost_windows().
+ *
+ * A half arriving twice before the other one means an interrupt was missed:
+ * the pairing is no longer trustworthy, so it is counted in isr_violations()
+ * and the next complete window only primes, exactly as after restart().
+ *
+ * The first window ending after restart() is dropped: it only primes the
+ * previous snapshot and residue, as the integrator state at the start of it
+ * is unknown (RESTART) or it mixes two configurations (FREE_RUNNING).
+ * Dropped windows still advance the tracked snapshot, so no reset of the
+ * counters is ever needed to resume.
+ *
+ * Autozero: windows alternate between the selected input and REF0. The DG408
+ * is switched by the window end ISR itself (input_switch_from_isr()), so
+ * every window reads a single source and no superloop round trip is needed;
+ * the source of each window travels with its record in flags.
+ *
+ * Drift tracking: outside autozero, request_drift_window() makes the window
+ * end ISR switch the DG408 to a reference for exactly one window and back;
+ * the stolen window is tagged RECORD_DRIFT_ZERO or RECORD_DRIFT_SPAN.
+ *
+ * Burst: start_burst() makes the ISRs write the next windows straight into
+ * a caller's BurstSample block instead of the queue, so the superloop has
+ * nothing to do until burst_count() reaches the size (later windows are
+ * dropped until stop_burst()). The first window after start_burst() primes.
+ *
+ * The superloop drains the queue in batches:
+ *   uint8_t n = acquisition.available();
+ *   for (uint8_t i = 0; i < n; ++i) { use(acquisition.peek(i)); }
+ *   acquisition.consume(n);
+ */
+class Acquisition {
+public:
+    static constexpr uint8_t queue_depth = 32;
+
+private:
+    static constexpr uint8_t COUNTS_READY = 0x01;
+    static constexpr uint8_t RESIDUE_READY = 0x02;
+    static constexpr uint8_t WINDOW_READY = COUNTS_READY | RESIDUE_READY;
+
+    SpscQueue<WindowRecord, queue_depth> m_queue;
+
+    // ISR owned, main loop only touches them inside restart()
+    uint32_t m_snapshot;
+    uint32_t m_previous_snapshot;
+    uint32_t m_period;
+    int16_t m_residue;
+    int16_t m_previous_residue;
+    uint32_t m_index;
+    uint8_t m_pending;
+    uint8_t m_skip;
+
+    // Monotonic loss counters, written by the ISRs only
+    uint32_t m_lost_windows;
+    uint32_t m_isr_violations;
+
+    CountingMode m_mode;
+
+    // Autozero: m_input is the selected input, m_zero_phase true while the
+    // window in progress reads REF0, m_window_flags tag the last ended window.
+    InputSource m_input;
+    bool m_autozero;
+    bool m_zero_phase;
+    uint8_t m_window_flags;
+
+    // Drift tracking: a request set by the main loop is taken by the next
+    // window end, m_steal_phase is true while the stolen window runs.
+    InputSource m_steal_source;
+    uint8_t m_steal_flags;
+    volatile bool m_steal_request;
+    bool m_steal_phase;
+
+    // Burst: m_burst_size is 0 when no burst is running.
+    BurstSample *m_burst_data;
+    uint16_t m_burst_size;
+    volatile uint16_t m_burst_count;
+
+    inline void complete_from_isr(void) {
+        if (m_pending != WINDOW_READY) {
+            return;
+        }
+        m_pending = 0;
+        if (m_skip) {
+            --m_skip;
+        } else if (m_burst_size) {
+            if (m_burst_count < m_burst_size) {
+                BurstSample &sample = m_burst_data[m_burst_count];
+                sample.negative_counts = static_cast<uint16_t>(m_snapshot - m_previous_snapshot);
+                sample.residue_delta = static_cast<int16_t>(m_residue - m_previous_residue);
+                m_burst_count = m_burst_count + 1;
+            }
+        } else {
+            WindowRecord record;
+            record.negative_counts = m_snapshot - m_previous_snapshot;  // modulo 2^32
+            record.period = m_period;
+            record.residue = m_residue;
+            record.residue_delta = static_cast<int16_t>(m_residue - m_previous_residue);
+            record.index = m_index;
+            record.flags = m_window_flags;
+            if (!m_queue.push(record)) {
+                ++m_lost_windows;
+            }
+        }
+        ++m_index;
+        m_previous_snapshot = m_snapshot;
+        m_previous_residue = m_residue;
+    }
+
+    inline void violation_from_isr(void) {
+        ++m_isr_violations;
+        m_pending = 0;
+        if (!m_skip) {
+            m_skip = 1;
+        }
+    }
+
+public:
+    // Window end ISR, before window_complete_from_isr(): tags the window that
+    // just ended and, in autozero or around a stolen window, returns in next
+    // the source of the one that just started. The caller must drive the
+    // DG408 when true is returned.
+    inline bool input_switch_from_isr(InputSource &next) {
+        if (m_autozero) {
+            m_window_flags = m_zero_phase ? (RECORD_AUTOZERO | RECORD_ZERO) : RECORD_AUTOZERO;
+            m_zero_phase = !m_zero_phase;
+            next = m_zero_phase ? InputSource::REF0 : m_input;
+            return true;
+        }
+        if (m_steal_phase) {
+            m_window_flags = m_steal_flags;
+            m_steal_phase = false;
+            next = m_input;
+            return true;
+        }
+        m_window_flags = 0;
+        if (!m_steal_request) {
+            return false;
+        }
+        m_steal_request = false;
+        m_steal_phase = true;
+        next = m_steal_source;
+        return true;
+    }
+
+    inline void window_complete_from_isr(uint32_t snapshot, uint32_t period) {
+        if (m_pending & COUNTS_READY) {
+            violation_from_isr();
+        }
+        m_snapshot = snapshot;
+        m_period = period;
+        m_pending |= COUNTS_READY;
+        complete_from_isr();
+    }
+
+    inline void residue_ready_from_isr(int16_t residue) {
+        if (m_pending & RESIDUE_READY) {
+            violation_from_isr();
+        }
+        m_residue = residue;
+        m_pending |= RESIDUE_READY;
+        complete_from_isr();
+    }
+
+    // Drop the window in progress: the next complete one only primes.
+    // A window already ended but half assembled is dropped too.
+    // Records already queued are left for the superloop: their number is
+    // returned, so a consumer can tell them apart from the ones that follow.
+    inline uint8_t restart(void) {
+        uint8_t queued;
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            m_skip = m_pending ? 2 : 1;
+            if (m_mode == CountingMode::RESTART) {
+                m_index = 0;
+            }
+            queued = m_queue.available();
+        }
+        return queued;
+    }
+
+    // Source the DG408 must read now: REF0 during an autozero zero window.
+    // Call with interrupts disabled, together with the mux update.
+    inline InputSource set_input_no_atomic(InputSource source) {
+        m_input = source;
+        if (m_steal_phase) {
+            return m_steal_source;
+        }
+        return m_zero_phase ? InputSource::REF0 : source;
+    }
+
+    // Same contract as set_input_no_atomic(): leaving autozero ends a zero
+    // phase, the returned source is the one to select.
+    inline InputSource set_autozero_no_atomic(bool enable) {
+        m_autozero = enable;
+        if (!enable) {
+            m_zero_phase = false;
+        }
+        m_steal_request = false;
+        m_steal_phase = false;
+        return m_zero_phase ? InputSource::REF0 : m_input;
+    }
+
+    // Steal the next window for a reference reading, ignored in autozero
+    // (the zero is tracked there already) or while a steal is in progress.
+    inline bool request_drift_window(InputSource source) {
+        bool requested = false;
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            if (!m_autozero && !m_steal_request && !m_steal_phase) {
+                m_steal_source = source;
+                m_steal_flags = source == InputSource::REF0 ? RECORD_DRIFT_ZERO : RECORD_DRIFT_SPAN;
+                m_steal_request = true;
+                requested = true;
+            }
+        }
+        return requested;
+    }
+
+    // Drop a pending or running steal: the caller is about to drive the DG408
+    // itself. Call with interrupts disabled, together with the mux update.
+    inline void cancel_drift_window_no_atomic(void) {
+        m_steal_request = false;
+        m_steal_phase = false;
+    }
+
+    inline bool autozero(void) const {
+        return m_autozero;
+    }
+
+    // Store the next size windows (after one priming window) into data.
+    // The caller keeps the period constant and at most 65535 meanwhile.
+    // A pending drift steal is dropped, a running one ends with the window
+    // in progress, which is dropped anyway.
+    inline void start_burst(BurstSample *data, uint16_t size) {
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            m_steal_request = false;
+            m_burst_data = data;
+            m_burst_size = size;
+            m_burst_count = 0;
+            restart();
+        }
+    }
+
+    inline void stop_burst(void) {
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            m_burst_size = 0;
+        }
+    }
+
+    inline bool burst_running(void) const {
+        uint16_t size;
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            size = m_burst_size;
+        }
+        return size != 0;
+    }
+
+    // Windows stored so far, the burst is complete at its size.
+    inline uint16_t burst_count(void) const {
+        uint16_t count;
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            count = m_burst_count;
+        }
+        return count;
+    }
+
+    inline void set_counting_mode(CountingMode mode) {
+        m_mode = mode;
+    }
+
+    inline CountingMode counting_mode(void) const {
+        return m_mode;
+    }
+
+    inline bool free_running(void) const {
+        return m_mode == CountingMode::FREE_RUNNING;
+    }
+
+    inline uint32_t lost_windows(void) const {
+        uint32_t count;
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            count = m_lost_windows;
+        }
+        return count;
+    }
+
+    inline uint32_t isr_violations(void) const {
+        uint32_t count;
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            count = m_isr_violations;
+        }
+        return count;
+    }
+
+    inline uint8_t available(void) const {
+        return m_queue.available();
+    }
+
+    inline const WindowRecord &peek(uint8_t i) const {
+        return m_queue.peek(i);
+    }
+
+    inline void consume(uint8_t n) {
+        m_queue.consume(n);
+    }
+
+    inline void flush(void) {
+        m_queue.flush();
+    }
+};
@@ -1,5 +1,13 @@
 #pragma once
 #include <stdint.h>
+#include "wide_mul.h"
+
+/* Input domain of pack_q0_32() and pack_q0_32_fast(), see the invariants below */
+#define Q0_32_FRAC_DEN_MIN  2049u      /* D > 2048 */
+#define Q0_32_FRAC_DEN_MAX  4094u      /* D < 4095 */
+#define Q0_32_PERIOD_MAX    1500000ul  /* J, PLC_200 at 50 Hz */
+#define Q0_32_FRAC_DEN_NOMINAL 3072u   /* ADC counts per reference cycle, uncalibrated */
+
 /**
  * @brief Convert charge-balance measurement components to a unified 32-bit fixed-point value.
  *
@@ -24,13 +32,15 @@
  * - K, D are uint16_t
  * - D is a fixed, calibrated constant with: 2048 < D < 4095
  * - 0 <= K < D
- * - J <= 750000
+ * - J <= 1500000 (PLC_200 at 50 Hz)
  * - By construction, (I + K/D) < J  ->  x < 1
  *
  * Under these conditions:
- * - denom = J * D fits in 32 bits
+ * - denom = J * D fits in 33 bits, in 32 bits when J <= 750000
  * - numer = I * D + K fits in 64 bits
- * - All intermediate computations are safe using only uint64_t
+ * - All intermediate computations are safe using only uint64_t: a 32-bit
+ *   denominator takes a single division, a 33-bit one is split in two
+ *   16-bit quotient steps so that (numer << 32) never overflows
  * - No floating-point arithmetic is used
  * - No precomputation or calibration constants are required
  *
@@ -55,12 +65,122 @@
 static inline uint32_t pack_q0_32(uint32_t I, uint16_t K,
                                   uint32_t J, uint16_t D)
 {
-    uint32_t denom = (uint32_t)(J * (uint32_t)D);
+    uint64_t denom = (uint64_t)J * (uint32_t)D;
     uint64_t numer = (uint64_t)I * (uint32_t)D + (uint32_t)K;
 
-    if (numer >= (uint64_t)denom)
+    if (numer >= denom)
         return 0xFFFFFFFFu;
 
-    uint64_t num_scaled = (numer << 32) + (uint64_t)(denom / 2u);
-    return (uint32_t)(num_scaled / denom);
+    if (denom <= 0xFFFFFFFFu) {
+        uint64_t num_scaled = (numer << 32) + (denom / 2u);
+        return (uint32_t)(num_scaled / denom);
+    }
+
+    // numer < denom < 2^33: numer << 16 and remainder << 16 stay below 2^49.
+    uint64_t step = numer << 16;
+    uint32_t high = (uint32_t)(step / denom);
+    step = ((step % denom) << 16) + (denom / 2u);
+    return (high << 16) + (uint32_t)(step / denom);
+}
+
+/**
+ * @brief Cached reciprocal of the denominator J * D used by pack_q0_32_fast().
+ *
+ * The window length J changes only with the WindowCounter setters and
+ * D only on calibration, so the single expensive division is moved here and
+ * every conversion becomes multiplications, shifts and compares.
+ *
+ * The denominator is normalized to dn = denom * 2^shift in [2^31, 2^32) and
+ * the reciprocal is stored with its implicit leading one:
+ *
+ *     inverse = floor((2^64 - 1) / dn) - 2^32
+ */
+typedef struct {
+    uint64_t denom;     ///< J * D
+    uint32_t inverse;   ///< Normalized reciprocal of denom without the 2^32 bit
+    int8_t shift;       ///< Normalization shift, -1 only when denom >= 2^32
+    uint32_t J;         ///< Cache key: window length
+    uint16_t D;         ///< Cache key: fractional denominator
+} Q032Reciprocal;
+
+/**
+ * @brief Precompute the reciprocal of J * D (one 64/32 division).
+ *
+ * Same invariants as pack_q0_32(): 2048 < D < 4095, J <= 1500000.
+ *
+ * constexpr, so the window table gets its reciprocals at compile time; there
+ * the product is plain C, the asm kernel only runs at run time.
+ */
+static inline constexpr void q0_32_reciprocal(Q032Reciprocal *r, uint32_t J, uint16_t D)
+{
+    r->J = J;
+    r->D = D;
+    r->denom = __builtin_is_constant_evaluated() ? (uint64_t)J * D : mul_u32_u16(J, D);
+
+    int8_t shift = 0;
+    uint64_t dn = r->denom;
+    while (dn > 0xFFFFFFFFu) {
+        dn >>= 1;
+        --shift;
+    }
+    while (dn < 0x80000000u) {
+        dn <<= 1;
+        ++shift;
+    }
+    r->shift = shift;
+    r->inverse = (uint32_t)(0xFFFFFFFFFFFFFFFFull / (uint32_t)dn);  // drops the 2^32 bit
+}
+
+/**
+ * @brief Division-free equivalent of pack_q0_32().
+ *
+ * Returns exactly the same value as pack_q0_32(I, K, r->J, r->D), so the
+ * <= 0.5 LSB rounding guarantee and the saturation behavior are unchanged.
+ *
+ * --- Algorithm ---
+ * 1. n32 = numer scaled by the same shift as the denominator (numer < denom,
+ *    so n32 < 2^32) and q = n32 + ((n32 * inverse) >> 32), an estimate of
+ *    numer * 2^32 / denom within two units of the rounded result.
+ * 2. The rounding remainder  rem = numer * 2^32 + denom / 2 - q * denom
+ *    is computed modulo 2^64: its true value is small, so it is exact once
+ *    read as signed, and q is stepped until 0 <= rem < denom.
+ *
+ * Both q < 2^33 and denom < 2^33, so the low half of q * denom is a single
+ * 32x32->64 product plus the cross terms of the two 2^32 bits, which are
+ * plain 32-bit additions.
+ *
+ * Cost: one 32x16->48 and two 32x32->64 products from wide_mul.h and a
+ * couple of compares, against the libgcc 64-bit division of pack_q0_32().
+ */
+static inline uint32_t pack_q0_32_fast(uint32_t I, uint16_t K,
+                                       const Q032Reciprocal *r)
+{
+    uint64_t numer = mul_u32_u16(I, r->D) + (uint32_t)K;
+
+    if (numer >= r->denom)
+        return 0xFFFFFFFFu;
+
+    uint32_t n32 = (uint32_t)(r->shift >= 0 ? numer << r->shift : numer >> -r->shift);
+    uint64_t q = n32 + (mul_u32_u32(n32, r->inverse) >> 32);
+
+    // q * denom modulo 2^64
+    uint32_t q_lo = (uint32_t)q;
+    uint32_t d_lo = (uint32_t)r->denom;
+    uint32_t cross = 0;
+    if (q >> 32)
+        cross += d_lo;
+    if (r->denom >> 32)
+        cross += q_lo;
+    uint64_t qd = mul_u32_u32(q_lo, d_lo) + ((uint64_t)cross << 32);
+
+    int64_t rem = (int64_t)((numer << 32) + (r->denom >> 1) - qd);
+    while (rem < 0) {
+        --q;
+        rem += (int64_t)r->denom;
+    }
+    while (rem >= (int64_t)r->denom) {
+        ++q;
+        rem -= (int64_t)r->denom;
+    }
+    return (uint32_t)q;
 }
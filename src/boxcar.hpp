@@ -0,0 +1,113 @@
+/*
+ * boxcar.hpp
+ *
+ * Sliding sum of the last N sub-windows, one reading per sub-window.
+ *
+ * Created: 10/16/2026
+ *  Author: uliano
+ */
+
+#pragma once
+#include <stdint.h>
+#include "acquisition.hpp"
+#include "arithmetic.h"
+
+constexpr uint8_t BOXCAR_MAX = 50;  // 1 PLC of PLC_0_02 sub-windows
+
+/*
+ * Boxcar
+ *
+ * Consecutive windows add up exactly: the negative counts and the periods
+ * sum, the residue differences telescope to the difference across the whole
+ * span. So the last N records summed are the record of one window N times
+ * longer, ending now, and every new sub-window gives one such window for the
+ * price of an add and a subtract. Short sub-windows with N of them making a
+ * whole number of PLC give full line rejection at the sub-window rate.
+ *
+ * The sum is converted like any record: its period is the same for every
+ * output (N times the sub-window), so the Converter keeps the reciprocal.
+ *
+ * A gap in the window index (restart, dropped window, a window stolen by
+ * drift tracking or any other window not added) empties the sum: the next
+ * output comes N sub-windows later.
+ */
+class Boxcar {
+private:
+    struct Entry {
+        uint32_t negative_counts;
+        uint32_t period;
+        int16_t residue_delta;
+    };
+
+    Entry m_entries[BOXCAR_MAX];
+    uint8_t m_length = 0;   // N, 0 when off
+    uint8_t m_count = 0;    // entries in the sum
+    uint8_t m_head = 0;     // oldest entry, overwritten next
+    uint32_t m_negative_counts;
+    uint32_t m_period;
+    int16_t m_residue_delta;
+    uint32_t m_next_index;
+
+public:
+    inline void reset(void) {
+        m_count = 0;
+        m_head = 0;
+        m_negative_counts = 0;
+        m_period = 0;
+        m_residue_delta = 0;
+    }
+
+    // 0 turns the boxcar off; false (nothing changed) above BOXCAR_MAX.
+    inline bool set_length(uint8_t length) {
+        if (length > BOXCAR_MAX) {
+            return false;
+        }
+        m_length = length;
+        reset();
+        return true;
+    }
+
+    inline uint8_t length(void) const {
+        return m_length;
+    }
+
+    /**
+     * @brief Slide the sum by one sub-window.
+     *
+     * @param sum  the last N records as one, when full
+     * @return true when sum holds N windows inside the Q0.32 domain
+     */
+    bool add(const WindowRecord &record, WindowRecord &sum) {
+        if (m_count && record.index != m_next_index) {
+            reset();
+        }
+        m_next_index = record.index + 1u;
+
+        Entry &entry = m_entries[m_head];
+        if (m_count == m_length) {
+            m_negative_counts -= entry.negative_counts;
+            m_period -= entry.period;
+            m_residue_delta = static_cast<int16_t>(m_residue_delta - entry.residue_delta);
+        } else {
+            ++m_count;
+        }
+        entry.negative_counts = record.negative_counts;
+        entry.period = record.period;
+        entry.residue_delta = record.residue_delta;
+        m_negative_counts += record.negative_counts;
+        m_period += record.period;
+        m_residue_delta = static_cast<int16_t>(m_residue_delta + record.residue_delta);
+        if (++m_head == m_length) {
+            m_head = 0;
+        }
+
+        if (m_count < m_length || m_period > Q0_32_PERIOD_MAX) {
+            return false;
+        }
+        sum = record;
+        sum.negative_counts = m_negative_counts;
+        sum.period = m_period;
+        sum.residue_delta = m_residue_delta;
+        return true;
+    }
+};
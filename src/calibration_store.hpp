@@ -0,0 +1,170 @@
+/*
+ * calibration_store.hpp
+ *
+ * Versioned, CRC protected calibration record in EEPROM, two slots.
+ *
+ * Created: 10/16/2026
+ *  Author: uliano
+ */
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <avr/eeprom.h>
+#include <util/crc16.h>
+#include "conversion.hpp"
+#include "window_length.hpp"
+
+constexpr uint16_t CALIBRATION_MAGIC = 0x4D53;  // "MS"
+constexpr uint8_t CALIBRATION_VERSION = 1;
+
+struct CalibrationRecord {
+    uint16_t magic;
+    uint8_t version;
+    uint8_t sequence;        // incremented at every save, modulo 256
+    Calibration cal;         // D, offset, span
+    InlTable inl;
+    uint8_t inl_enabled;
+    uint8_t grid_frequency;  // raw GridFrequency value
+    uint16_t crc;            // CRC-CCITT of all the bytes above
+};
+
+constexpr uint8_t CALIBRATION_SLOTS = 2;
+constexpr uint16_t CALIBRATION_SLOT_SIZE = sizeof(CalibrationRecord);
+static_assert(sizeof(CalibrationRecord) < 256, "write index is 8 bits");
+static_assert(CALIBRATION_SLOTS * CALIBRATION_SLOT_SIZE <= 512, "calibration slots exceed the EEPROM");
+
+/*
+ * Calibration store
+ *
+ * Two copies of the record live at the bottom of the EEPROM. load() picks the
+ * valid slot (magic, version and CRC) with the newest sequence number, save()
+ * always writes the other one, so a reset or brown-out in the middle of a
+ * write leaves the previous record intact and each slot sees half the writes.
+ *
+ * An EEPROM byte write takes milliseconds: save() only copies the record, the
+ * superloop calls service() which hands one byte to the NVM controller when it
+ * is idle, never waiting for it. eeprom_update_byte() skips the bytes that
+ * already hold the right value, so storing an unchanged calibration costs no
+ * erase cycle at all. The CRC is the last field written.
+ */
+class CalibrationStore {
+private:
+    CalibrationRecord m_pending;
+    uint8_t m_write_index = 0;  // bytes of m_pending already written
+    uint8_t m_write_slot = 0;
+    bool m_writing = false;
+    bool m_valid = false;       // a valid record was loaded or written
+    uint8_t m_slot = 0;         // slot of the newest valid record
+    uint8_t m_sequence = 0;
+
+    static inline uint8_t *slot_address(uint8_t slot) {
+        return reinterpret_cast<uint8_t *>(static_cast<uintptr_t>(slot) * CALIBRATION_SLOT_SIZE);
+    }
+
+    static inline uint16_t crc_of(const CalibrationRecord &record) {
+        const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&record);
+        uint16_t crc = 0xFFFF;
+        for (uint8_t i = 0; i < offsetof(CalibrationRecord, crc); ++i) {
+            crc = _crc_ccitt_update(crc, bytes[i]);
+        }
+        return crc;
+    }
+
+    static inline bool read_slot(uint8_t slot, CalibrationRecord &record) {
+        eeprom_read_block(&record, slot_address(slot), sizeof(record));
+        return record.magic == CALIBRATION_MAGIC && record.version == CALIBRATION_VERSION &&
+               record.crc == crc_of(record);
+    }
+
+public:
+    // Newest valid record, false if neither slot holds one.
+    bool load(CalibrationRecord &record) {
+        m_valid = false;
+        for (uint8_t slot = 0; slot < CALIBRATION_SLOTS; ++slot) {
+            CalibrationRecord candidate;
+            if (!read_slot(slot, candidate)) {
+                continue;
+            }
+            if (!m_valid || static_cast<int8_t>(candidate.sequence - m_sequence) > 0) {
+                record = candidate;
+                m_valid = true;
+                m_slot = slot;
+                m_sequence = candidate.sequence;
+            }
+        }
+        return m_valid;
+    }
+
+    // Queue the record for writing, false if a write is still in progress.
+    bool save(const CalibrationRecord &record) {
+        if (m_writing) {
+            return false;
+        }
+        m_pending = record;
+        m_pending.magic = CALIBRATION_MAGIC;
+        m_pending.version = CALIBRATION_VERSION;
+        m_pending.sequence = m_valid ? static_cast<uint8_t>(m_sequence + 1u) : 0u;
+        m_pending.crc = crc_of(m_pending);
+        m_write_slot = m_valid ? static_cast<uint8_t>((m_slot + 1u) % CALIBRATION_SLOTS) : 0u;
+        m_write_index = 0;
+        m_writing = true;
+        return true;
+    }
+
+    // Superloop: at most one byte per call, only when the NVM is idle.
+    inline void service(void) {
+        if (!m_writing || !eeprom_is_ready()) {
+            return;
+        }
+        const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&m_pending);
+        eeprom_update_byte(slot_address(m_write_slot) + m_write_index, bytes[m_write_index]);
+        if (++m_write_index < sizeof(CalibrationRecord)) {
+            return;
+        }
+        m_writing = false;
+        m_valid = true;
+        m_slot = m_write_slot;
+        m_sequence = m_pending.sequence;
+    }
+
+    inline bool writing(void) const {
+        return m_writing;
+    }
+
+    inline bool valid(void) const {
+        return m_valid;
+    }
+
+    inline uint8_t sequence(void) const {
+        return m_sequence;
+    }
+
+    static inline bool grid_frequency_valid(uint8_t raw) {
+        return raw == static_cast<uint8_t>(GridFrequency::FREQ_50HZ) ||
+               raw == static_cast<uint8_t>(GridFrequency::FREQ_60HZ);
+    }
+
+    static CalibrationRecord make_record(const Converter &converter, GridFrequency grid_freq) {
+        CalibrationRecord record{};
+        record.cal = converter.calibration();
+        record.inl = converter.inl().table();
+        record.inl_enabled = converter.inl().enabled() ? 1u : 0u;
+        record.grid_frequency = static_cast<uint8_t>(grid_freq);
+        return record;
+    }
+
+    // All or nothing: a record with any field out of range changes nothing.
+    static bool install(const CalibrationRecord &record, Converter &converter) {
+        if (!frac_den_valid(record.cal.frac_den) || record.cal.span_uv == 0 ||
+            !grid_frequency_valid(record.grid_frequency)) {
+            return false;
+        }
+        if (!converter.inl().set_table(record.inl)) {
+            return false;
+        }
+        converter.inl().enable(record.inl_enabled != 0);
+        converter.set_calibration(record.cal);
+        return true;
+    }
+};
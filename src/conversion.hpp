@@ -0,0 +1,168 @@
+/*
+ * conversion.hpp
+ *
+ * Window record -> Q0.32 fraction -> calibrated reading.
+ *
+ * Created: 10/16/2026
+ *  Author: uliano
+ */
+
+#pragma once
+#include <stdint.h>
+#include "arithmetic.h"
+#include "acquisition.hpp"
+#include "window_length.hpp"
+#include "inl_correction.hpp"
+
+// Nominal values used until a calibration is installed.
+constexpr uint16_t NOMINAL_FRAC_DEN = Q0_32_FRAC_DEN_NOMINAL;
+constexpr int32_t NOMINAL_OFFSET_UV = -15000000;   // reading for x = 0
+constexpr int32_t NOMINAL_SPAN_UV = 30000000;      // reading(x -> 1) - reading(x = 0)
+
+constexpr bool frac_den_valid(uint16_t D) {
+    return D >= Q0_32_FRAC_DEN_MIN && D <= Q0_32_FRAC_DEN_MAX;
+}
+
+// Every window period is checked against Q0_32_PERIOD_MAX in window_length.hpp.
+static_assert(static_cast<uint64_t>(Q0_32_PERIOD_MAX) * Q0_32_FRAC_DEN_MAX < (1ull << 33),
+              "J * D must fit in 33 bits");
+static_assert(frac_den_valid(NOMINAL_FRAC_DEN), "nominal D outside the Q0.32 conversion domain");
+
+// Calibrated reading: microvolts + nanovolts / 1000, with 0 <= nanovolts < 1000.
+struct Reading {
+    int32_t microvolts;
+    uint16_t nanovolts;
+};
+
+struct Calibration {
+    uint16_t frac_den;   // D of pack_q0_32, 2048 < D < 4095
+    int32_t offset_uv;
+    int32_t span_uv;
+};
+
+/*
+ * Conversion stage run by the superloop on every drained WindowRecord.
+ *
+ * The residue difference is signed and may exceed one reference cycle, so it
+ * is first folded into the (I, K) pair required by pack_q0_32 (0 <= K < D):
+ * |residue_delta| < 4096 and D > 2048, hence at most two correction steps.
+ *
+ * The reciprocal of J * D is cached and refreshed only when the record
+ * period or the calibrated denominator differ from the cached ones, so the
+ * per-window cost is pack_q0_32_fast() instead of a 64-bit division. With the
+ * nominal D the refresh is a copy from window_table, otherwise one division.
+ *
+ * The INL correction, when enabled, is applied to every fraction right after
+ * pack_q0_32_fast(), so zero windows and reference points see it too.
+ *
+ * The Q0.32 fraction is what gets stored: it is lossless and unit agnostic,
+ * the linear calibration to microvolts is applied when the reading is output.
+ */
+// Fraction that reads 0 uV with the given calibration, clamped to Q0.32.
+constexpr uint32_t zero_fraction_of(const Calibration &cal) {
+    if (cal.span_uv == 0) {
+        return 0;
+    }
+    const int64_t x = (-static_cast<int64_t>(cal.offset_uv) * 4294967296ll) / cal.span_uv;
+    return x < 0 ? 0u : (x > 0xFFFFFFFFll ? 0xFFFFFFFFu : static_cast<uint32_t>(x));
+}
+
+class Converter {
+private:
+    Calibration m_cal{NOMINAL_FRAC_DEN, NOMINAL_OFFSET_UV, NOMINAL_SPAN_UV};
+    Q032Reciprocal m_reciprocal{};  // J == 0: nothing cached yet
+    uint32_t m_zero_fraction = zero_fraction_of(m_cal);
+    InlCorrection m_inl;
+
+    inline uint32_t pack(uint32_t I, uint16_t K, uint32_t period) {
+        if (period != m_reciprocal.J || m_cal.frac_den != m_reciprocal.D) {
+            const WindowParams *params = find_window_params(period);
+            if (params && params->reciprocal.D == m_cal.frac_den) {
+                m_reciprocal = params->reciprocal;  // nominal D: precomputed
+            } else {
+                q0_32_reciprocal(&m_reciprocal, period, m_cal.frac_den);
+            }
+        }
+        return m_inl.apply(pack_q0_32_fast(I, K, &m_reciprocal));
+    }
+
+public:
+    // Rejects a D outside the pack_q0_32 domain, the previous one is kept.
+    inline bool set_calibration(const Calibration &cal) {
+        if (!frac_den_valid(cal.frac_den)) {
+            return false;
+        }
+        m_cal = cal;
+        m_zero_fraction = zero_fraction_of(cal);
+        return true;
+    }
+
+    inline uint32_t zero_fraction(void) const {
+        return m_zero_fraction;
+    }
+
+    inline const Calibration &calibration(void) const {
+        return m_cal;
+    }
+
+    inline InlCorrection &inl(void) {
+        return m_inl;
+    }
+
+    inline const InlCorrection &inl(void) const {
+        return m_inl;
+    }
+
+    uint32_t to_q0_32(const WindowRecord &record) {
+        const int16_t D = static_cast<int16_t>(m_cal.frac_den);
+        uint32_t I = record.negative_counts;
+        int16_t K = record.residue_delta;
+        while (K < 0) {
+            if (I == 0) {
+                return 0;  // below the bottom of the range
+            }
+            --I;
+            K += D;
+        }
+        while (K >= D) {
+            ++I;
+            K -= D;
+        }
+        return pack(I, static_cast<uint16_t>(K), record.period);
+    }
+
+    // Weighted sum of windows (sinc_decimator.hpp): the residue term spans
+    // many reference cycles and is folded with one division, paid at the
+    // decimated rate only.
+    uint32_t to_q0_32(uint32_t negative_counts, int32_t residue, uint32_t period) {
+        const int32_t D = m_cal.frac_den;
+        int32_t cycles = residue / D;
+        int32_t K = residue % D;
+        if (K < 0) {
+            K += D;
+            --cycles;
+        }
+        if (cycles < 0 && negative_counts < static_cast<uint32_t>(-cycles)) {
+            return 0;  // below the bottom of the range
+        }
+        return pack(negative_counts + static_cast<uint32_t>(cycles), static_cast<uint16_t>(K), period);
+    }
+
+    inline int32_t to_microvolts(uint32_t fraction) const {
+        return m_cal.offset_uv + mulhi_s32_u32(m_cal.span_uv, fraction);
+    }
+
+    // Same product kept to nanovolts: its upper word is the microvolts (as in
+    // to_microvolts()), the lower word the Q0.32 fraction of a microvolt,
+    // scaled to 0..999 by a 32 x 16 product. No 64-bit division.
+    inline Reading to_reading(uint32_t fraction) const {
+        uint64_t product = mul_u32_u32(static_cast<uint32_t>(m_cal.span_uv), fraction);
+        if (m_cal.span_uv < 0) {
+            product -= static_cast<uint64_t>(fraction) << 32;
+        }
+        Reading reading;
+        reading.microvolts = m_cal.offset_uv + static_cast<int32_t>(static_cast<uint32_t>(product >> 32));
+        reading.nanovolts = static_cast<uint16_t>(mul_u32_u16(static_cast<uint32_t>(product), 1000u) >> 32);
+        return reading;
+    }
+};
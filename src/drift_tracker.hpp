@@ -0,0 +1,112 @@
+/*
+ * drift_tracker.hpp
+ *
+ * Offset and gain drift tracking from occasionally stolen reference windows.
+ *
+ * Created: 10/16/2026
+ *  Author: uliano
+ */
+
+#pragma once
+#include <stdint.h>
+#include "input_source.h"
+
+constexpr InputSource DRIFT_SPAN_SOURCE = InputSource::REF10;
+
+/*
+ * Drift tracker
+ *
+ * Every few seconds the window end ISR steals one window from the input and
+ * reads REF0 or DRIFT_SPAN_SOURCE instead (Acquisition::request_drift_window()).
+ * Both readings are low pass filtered in the Q0.32 domain like the autozero
+ * zero: f += (x - f) / 2^FILTER_SHIFT, the state keeping the extra bits.
+ *
+ * The first reading of each point is its baseline: the calibration in force
+ * was good then. Later input readings are mapped back onto the baseline by
+ * the straight line through the two points:
+ *     x' = base0 + (x - f0) * gain,   gain = (base1 - base0) / (f1 - f0)
+ * gain in Q2.30, so the correction costs one 64-bit product per reading.
+ * Until both points have been read, only the offset is tracked (gain = 1).
+ *
+ * Like the autozero correction this keeps the stored fractions in the domain
+ * of the installed calibration, so readings already in meas_buffer are never
+ * reinterpreted. A new calibration changes that domain: reset() the tracker.
+ */
+class DriftTracker {
+public:
+    static constexpr uint8_t FILTER_SHIFT = 2;
+    static constexpr uint32_t GAIN_ONE = 1ul << 30;
+
+private:
+    uint64_t m_state[2];   // filtered reading << FILTER_SHIFT, [0] zero, [1] span
+    uint32_t m_base[2];
+    bool m_valid[2] = {false, false};
+    uint32_t m_gain = GAIN_ONE;
+
+    inline uint32_t filtered(uint8_t point) const {
+        return static_cast<uint32_t>(m_state[point] >> FILTER_SHIFT);
+    }
+
+public:
+    inline void reset(void) {
+        m_valid[0] = false;
+        m_valid[1] = false;
+        m_gain = GAIN_ONE;
+    }
+
+    /**
+     * @brief Filter one stolen window.
+     *
+     * @param span  true for a DRIFT_SPAN_SOURCE window, false for REF0
+     * @return true if the correction changed
+     */
+    bool update(bool span, uint32_t fraction) {
+        const uint8_t point = span ? 1 : 0;
+        if (!m_valid[point]) {
+            m_state[point] = static_cast<uint64_t>(fraction) << FILTER_SHIFT;
+            m_base[point] = fraction;
+            m_valid[point] = true;
+        } else {
+            m_state[point] = m_state[point] - (m_state[point] >> FILTER_SHIFT) + fraction;
+        }
+        if (!m_valid[0] || !m_valid[1]) {
+            return point == 0;
+        }
+        const int64_t now = static_cast<int64_t>(filtered(1)) - filtered(0);
+        const int64_t base = static_cast<int64_t>(m_base[1]) - m_base[0];
+        if (now <= 0 || base <= 0 || base >= 2 * now || 2 * base <= now) {
+            return point == 0;  // span not measurable or gain outside 0.5 .. 2: offset only
+        }
+        m_gain = static_cast<uint32_t>((base << 30) / now);
+        return true;
+    }
+
+    inline bool valid(void) const {
+        return m_valid[0];
+    }
+
+    inline uint32_t correct(uint32_t fraction) const {
+        if (!m_valid[0]) {
+            return fraction;
+        }
+        const int64_t dx = static_cast<int64_t>(fraction) - filtered(0);
+        const int64_t corrected = m_base[0] + ((dx * m_gain) >> 30);
+        if (corrected < 0) {
+            return 0;
+        }
+        if (corrected > 0xFFFFFFFFll) {
+            return 0xFFFFFFFFu;
+        }
+        return static_cast<uint32_t>(corrected);
+    }
+
+    // Zero drift since the baseline, Q0.32 units.
+    inline int32_t zero_drift(void) const {
+        return m_valid[0] ? static_cast<int32_t>(filtered(0) - m_base[0]) : 0;
+    }
+
+    // Correction gain, Q2.30.
+    inline uint32_t gain(void) const {
+        return m_gain;
+    }
+};
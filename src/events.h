@@ -4,10 +4,10 @@
 // Event channel assignment.
 enum {
     EVENT_HEARTBEAT = 0,   // TCA0 OVF -> LUT0 & LUT1 & LUT2A clock & TCB2 count 
-    EVENT_WINDOW_COMPLETE = 1,   // TCB3 OVF -> End of WINDOW
+    EVENT_WINDOW_COMPLETE = 1,   // TCB3 OVF -> End of WINDOW & TCB1 capture
     EVENT_TCB2_OVF = 2, // TCB2 OVF -> TCB3 COUNT
     EVENT_AC_SYNC = 3,   // LUT2 output -> LUT0 select PWM_PATTERN
-    EVENT_NEG_CLK = 4,   // LUT1 output -> TCB0 count
+    EVENT_NEG_CLK = 4,   // LUT1 output -> TCB1 count
 };
 
 
@@ -38,6 +38,8 @@ static inline void init_events(void)
     
     // Negative pulses are counted by NegativeCounter.
     EVSYS.USERTCB1COUNT = (uint8_t)(EVENT_NEG_CLK + 1u);
+    // and latched in hardware at window end.
+    EVSYS.USERTCB1CAPT = (uint8_t)(EVENT_WINDOW_COMPLETE + 1u);
     
     // Ripple overflow for the 32bit WindowCounter.
     EVSYS.USERTCB3COUNT = (uint8_t)(EVENT_TCB2_OVF + 1u);
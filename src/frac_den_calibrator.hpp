@@ -0,0 +1,126 @@
+/*
+ * frac_den_calibrator.hpp
+ *
+ * Background estimate of D, the ADC counts spanned by one reference cycle.
+ *
+ * Created: 10/16/2026
+ *  Author: uliano
+ */
+
+#pragma once
+#include <stdint.h>
+#include "conversion.hpp"
+
+/*
+ * Frac_Den calibration engine
+ *
+ * Over many windows the residue left in the integrator wanders over exactly one
+ * reference cycle worth of charge, so MaxADC - MinADC of the residues is D.
+ * The engine is fed with the residue of every window drained by the superloop,
+ * it never touches the counters or the ADC and the acquisition goes on.
+ *
+ * Outlier rejection: the TRIM most extreme residues at each end are discarded
+ * (a glitch, a window spanning an input change), the estimate uses the
+ * (TRIM + 1)-th smallest and largest ones. For N residues spread uniformly
+ * over D codes those order statistics are (N - 1 - 2 * TRIM) / (N + 1) of D
+ * apart on average, and the span is scaled back by that factor.
+ *
+ * A run lasts exactly the number of windows given to start(): the result is
+ * DONE if the estimate is inside the pack_q0_32 domain, FAILED otherwise
+ * (e.g. an input that keeps the residue in a narrow band). The spread of the
+ * estimate shrinks as D / N: about +-10 counts at 1024 windows, about +-1
+ * count from 16384 windows on.
+ */
+class FracDenCalibrator {
+public:
+    static constexpr uint8_t TRIM = 8;
+    static constexpr uint16_t MIN_WINDOWS = 256;
+
+    enum class State : uint8_t {
+        IDLE,
+        RUNNING,
+        DONE,
+        FAILED
+    };
+
+private:
+    int16_t m_low[TRIM + 1];   // smallest residues so far, ascending
+    int16_t m_high[TRIM + 1];  // largest residues so far, descending
+    uint16_t m_windows;
+    uint16_t m_remaining;
+    uint16_t m_result;
+    State m_state = State::IDLE;
+
+    inline void finish(void) {
+        const int32_t span = static_cast<int32_t>(m_high[TRIM]) - m_low[TRIM];
+        const uint32_t den = m_windows - 1u - 2u * TRIM;
+        if (span <= 0) {
+            m_state = State::FAILED;
+            return;
+        }
+        const uint32_t D = (static_cast<uint32_t>(span) * (m_windows + 1u) + den / 2u) / den;
+        if (D > 0xFFFFu || !frac_den_valid(static_cast<uint16_t>(D))) {
+            m_state = State::FAILED;
+            return;
+        }
+        m_result = static_cast<uint16_t>(D);
+        m_state = State::DONE;
+    }
+
+public:
+    // Start a run over the next windows residues, a run in progress is dropped.
+    inline bool start(uint16_t windows) {
+        if (windows < MIN_WINDOWS) {
+            return false;
+        }
+        for (uint8_t i = 0; i <= TRIM; ++i) {
+            m_low[i] = 0x7FFF;
+            m_high[i] = -0x7FFF - 1;
+        }
+        m_windows = windows;
+        m_remaining = windows;
+        m_state = State::RUNNING;
+        return true;
+    }
+
+    // Returns true on the window that ends the run.
+    inline bool feed(int16_t residue) {
+        if (m_state != State::RUNNING) {
+            return false;
+        }
+        if (residue < m_low[TRIM]) {
+            uint8_t i = TRIM;
+            while (i > 0 && m_low[i - 1] > residue) {
+                m_low[i] = m_low[i - 1];
+                --i;
+            }
+            m_low[i] = residue;
+        }
+        if (residue > m_high[TRIM]) {
+            uint8_t i = TRIM;
+            while (i > 0 && m_high[i - 1] < residue) {
+                m_high[i] = m_high[i - 1];
+                --i;
+            }
+            m_high[i] = residue;
+        }
+        if (--m_remaining) {
+            return false;
+        }
+        finish();
+        return true;
+    }
+
+    inline State state(void) const {
+        return m_state;
+    }
+
+    inline uint16_t remaining(void) const {
+        return m_state == State::RUNNING ? m_remaining : 0;
+    }
+
+    // Valid when state() is DONE.
+    inline uint16_t result(void) const {
+        return m_result;
+    }
+};
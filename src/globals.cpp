@@ -8,18 +8,25 @@
  */ 
 #include "globals.hpp"
 
-Ring<Measurement, uint16_t, 1024> meas_buffer;
+MeasurementStore meas_buffer;
+
+// Must precede window_counter: its constructor restarts the acquisition
+// and the sample clock.
+SampleClock sample_clock;
+Acquisition acquisition;
+Converter converter;
+FracDenCalibrator frac_den_calibrator;
+ReferenceCalibrator reference_calibrator;
+ZeroFilter zero_filter;
+DriftTracker drift_tracker;
+CalibrationStore calibration_store;
+LineMonitor line_monitor;
+Boxcar boxcar;
+SincDecimator sinc_decimator;
+BurstSample burst_samples[BURST_MAX_WINDOWS];
 
 WindowCounter window_counter(WindowLength::PLC_1, GridFrequency::FREQ_50HZ);  
 NegativeCounter negative_counter;
 Uart<2, UART_ALTERNATE> usb(430200);
 Uart<4, UART_STANDARD> console(115200);  // PE0/PE1
 
-Globals global_data = {
-    .previous_charge = 0,
-    .charge_difference = 0,
-    .negative_counts = 0,
-    .status = Status::CLEAN
-};
-Globals *globals = &global_data;  
-
@@ -11,22 +11,35 @@
 #include <uart.hpp>
 #include "negative_counter.hpp"
 #include "window_counter.hpp"
-#include "status.h"
-#include "measurement.hpp"
+#include "acquisition.hpp"
+#include "conversion.hpp"
+#include "frac_den_calibrator.hpp"
+#include "reference_calibrator.hpp"
+#include "zero_filter.hpp"
+#include "drift_tracker.hpp"
+#include "calibration_store.hpp"
+#include "line_monitor.hpp"
+#include "boxcar.hpp"
+#include "sinc_decimator.hpp"
+#include "measurement_store.hpp"
+#include "sample_clock.hpp"
 
 // C++ objects with static storage, initialized before main() starts.
 extern WindowCounter window_counter;  
 extern NegativeCounter negative_counter;  
 extern Uart<2, UART_ALTERNATE> usb;	
 extern Uart<4, UART_STANDARD> console;
-extern Ring<Measurement, uint16_t, 1024> meas_buffer; 
-
-// Global variables are 'globbed' :-) into one struct.
-struct Globals {
-    volatile int16_t previous_charge;
-    volatile int16_t charge_difference;
-    volatile int32_t negative_counts;
-    volatile Status status;
-};
-extern Globals *globals;
+extern MeasurementStore meas_buffer;
+extern SampleClock sample_clock;
+extern Acquisition acquisition;
+extern Converter converter;
+extern FracDenCalibrator frac_den_calibrator;
+extern ReferenceCalibrator reference_calibrator;
+extern ZeroFilter zero_filter;
+extern DriftTracker drift_tracker;
+extern CalibrationStore calibration_store;
+extern LineMonitor line_monitor;
+extern Boxcar boxcar;
+extern SincDecimator sinc_decimator;
+extern BurstSample burst_samples[BURST_MAX_WINDOWS];
 
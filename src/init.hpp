@@ -5,11 +5,53 @@
 #include "events.h"
 #include "globals.hpp"
 #include "heartbeat.h"
+#include "line_sense.h"
 #include "luts.h"
 #include "pins.hpp" 
 #include "ticker.hpp"
 #include "vref.h"
 
+// Install the stored calibration before the first window is converted.
+static void load_calibration(void) {
+    CalibrationRecord record;
+    if (calibration_store.load(record) && CalibrationStore::install(record, converter)) {
+        window_counter.set_grid_frequency(static_cast<GridFrequency>(record.grid_frequency));
+        usb.print("Calibration: stored\n");
+    } else {
+        usb.print("Calibration: nominal\n");
+    }
+}
+
+// Interrupts are still off: poll the ZCD flag for up to LINE_DETECT_HEARTBEATS
+// and let the mains pick the grid the windows are multiples of. Overrides the
+// stored line frequency; without mains the stored (or nominal) one stays.
+constexpr uint32_t LINE_DETECT_HEARTBEATS = HEARTBEAT_HZ / 2;  // 0.5 s, 16 cycles at 40 Hz are 0.4 s
+
+static void detect_line_frequency(void) {
+    const uint8_t updates = line_monitor.updates();
+    uint16_t last = line_sense_timestamp();
+    uint32_t elapsed = 0;
+    while (elapsed < LINE_DETECT_HEARTBEATS && line_monitor.updates() == updates) {
+        const uint16_t now = line_sense_timestamp();
+        elapsed += static_cast<uint16_t>(now - last);
+        last = now;
+        if (ZCD1.STATUS & ZCD_CROSSIF_bm) {
+            ZCD1.STATUS = ZCD_CROSSIF_bm;
+            line_monitor.zero_cross_from_isr(now);
+        }
+    }
+    if (line_monitor.updates() == updates) {
+        usb.print("Mains: not detected\n");
+        return;
+    }
+    const GridFrequency grid_freq = line_monitor.grid_frequency();
+    usb.print(grid_freq == GridFrequency::FREQ_60HZ ? "Mains: 60 Hz" : "Mains: 50 Hz");
+    if (!window_counter.set_grid_frequency(grid_freq)) {
+        usb.print(", window too long for it, line frequency kept");
+    }
+    usb.print("\n");
+}
+
 static void init_all(void) {
     ClockInitCode clock_status = init_clocks();
 
@@ -34,10 +76,13 @@ static void init_all(void) {
     init_adc();
     init_luts();
     init_events();
+    init_line_sense();
+    load_calibration();
+    detect_line_frequency();
     // trick the linker allocate meas_buffer.
     // remove when meas_buffer is actually used in the code.
     // Measurement m;
-    // meas_buffer.put(m);
+    // meas_buffer.put(m, 0);
     // meas_buffer.get(m);
 }
 
@@ -0,0 +1,150 @@
+/*
+ * inl_correction.hpp
+ *
+ * Piecewise linear integral nonlinearity correction of Q0.32 readings.
+ *
+ * Created: 10/16/2026
+ *  Author: uliano
+ */
+
+#pragma once
+#include <stdint.h>
+#include "wide_mul.h"
+
+constexpr uint8_t INL_SEGMENT_BITS = 4;
+constexpr uint8_t INL_SEGMENTS = 1u << INL_SEGMENT_BITS;
+constexpr uint8_t INL_NODES = INL_SEGMENTS + 1;
+constexpr int32_t INL_CORRECTION_MAX = 1l << 28;  // |correction| < 1/16 of full scale
+
+// Correction in Q0.32 LSB at x = i / INL_SEGMENTS, i = 0 .. INL_SEGMENTS.
+struct InlTable {
+    int32_t node[INL_NODES];
+};
+
+/*
+ * INL correction
+ *
+ * The Q0.32 range is split in INL_SEGMENTS equal segments, so the segment of
+ * x is its top INL_SEGMENT_BITS bits (direct index, no search) and the
+ * position inside it is the remaining bits, left aligned as a Q0.32 weight:
+ *
+ *     c = node[i] + ((node[i + 1] - node[i]) * t) >> 32
+ *     x' = clamp(x + c)
+ *
+ * One mulhi_s32_u32() and a handful of 32-bit operations per reading
+ * (test/test_cycles counts them on the MCU). Nodes are bounded by
+ * INL_CORRECTION_MAX so the difference never overflows.
+ *
+ * The table starts as all zeros (identity, disabled). add_points() folds in
+ * corrections measured at arbitrary x, e.g. the residuals of the reference
+ * calibration, by linear interpolation between them (constant outside), so
+ * successive mappings accumulate on top of the correction already applied.
+ */
+class InlCorrection {
+private:
+    InlTable m_table{};
+    bool m_enabled = false;
+
+public:
+    inline uint32_t apply(uint32_t x) const {
+        if (!m_enabled) {
+            return x;
+        }
+        const uint8_t i = static_cast<uint8_t>(x >> (32 - INL_SEGMENT_BITS));
+        const uint32_t t = x << INL_SEGMENT_BITS;
+        const int32_t c0 = m_table.node[i];
+        const int32_t c = c0 + mulhi_s32_u32(m_table.node[i + 1] - c0, t);
+        const int64_t y = static_cast<int64_t>(x) + c;
+        if (y < 0) {
+            return 0;
+        }
+        if (y > 0xFFFFFFFFll) {
+            return 0xFFFFFFFFu;
+        }
+        return static_cast<uint32_t>(y);
+    }
+
+    inline void enable(bool on) {
+        m_enabled = on;
+    }
+
+    inline bool enabled(void) const {
+        return m_enabled;
+    }
+
+    inline const InlTable &table(void) const {
+        return m_table;
+    }
+
+    // Rejects a table with a node outside +-INL_CORRECTION_MAX.
+    inline bool set_table(const InlTable &table) {
+        for (uint8_t i = 0; i < INL_NODES; ++i) {
+            if (table.node[i] <= -INL_CORRECTION_MAX || table.node[i] >= INL_CORRECTION_MAX) {
+                return false;
+            }
+        }
+        m_table = table;
+        return true;
+    }
+
+    inline void clear(void) {
+        m_table = InlTable{};
+        m_enabled = false;
+    }
+
+    /**
+     * @brief Accumulate corrections measured at n points into the nodes.
+     *
+     * @param x           Q0.32 reading of every point (any order, n <= 8)
+     * @param correction  Q0.32 LSB to add to the reading at that point
+     * @return false (table unchanged) if a correction is 2 * INL_CORRECTION_MAX
+     *         or more, or a node would leave the allowed range
+     */
+    bool add_points(const uint32_t *x, const int32_t *correction, uint8_t n) {
+        if (n == 0 || n > 8) {
+            return false;
+        }
+        uint32_t px[8];
+        int32_t pc[8];
+        for (uint8_t k = 0; k < n; ++k) {  // insertion sort by x
+            // keeps the interpolation product below 2^62
+            if (correction[k] <= -2 * INL_CORRECTION_MAX || correction[k] >= 2 * INL_CORRECTION_MAX) {
+                return false;
+            }
+            uint8_t j = k;
+            while (j > 0 && px[j - 1] > x[k]) {
+                px[j] = px[j - 1];
+                pc[j] = pc[j - 1];
+                --j;
+            }
+            px[j] = x[k];
+            pc[j] = correction[k];
+        }
+
+        InlTable table = m_table;
+        uint8_t k = 0;
+        for (uint8_t i = 0; i < INL_NODES; ++i) {
+            const uint64_t node_x = static_cast<uint64_t>(i) << (32 - INL_SEGMENT_BITS);
+            while (k + 1 < n && px[k + 1] <= node_x) {
+                ++k;
+            }
+            int64_t c;
+            if (node_x <= px[0]) {
+                c = pc[0];
+            } else if (k + 1 >= n) {
+                c = pc[n - 1];
+            } else {
+                const int64_t dx = static_cast<int64_t>(px[k + 1]) - px[k];
+                const int64_t at = static_cast<int64_t>(node_x) - px[k];
+                c = pc[k] + ((static_cast<int64_t>(pc[k + 1]) - pc[k]) * at) / dx;
+            }
+            const int64_t node = table.node[i] + c;
+            if (node <= -INL_CORRECTION_MAX || node >= INL_CORRECTION_MAX) {
+                return false;
+            }
+            table.node[i] = static_cast<int32_t>(node);
+        }
+        m_table = table;
+        return true;
+    }
+};
@@ -1,21 +1,39 @@
 #pragma once
 #include <avr/io.h>
+#include <util/atomic.h>
 #include "globals.hpp"
+#include "input_source.h"
 
-enum class InputSource : uint8_t {
-    EXTERNAL = 0,
-    REF10 = 1,
-    REF5 = 2,
-    REF2_5 = 3,
-    REF0 = 4,
-    REF_2_5 = 5,
-    REF_5 = 6,
-    REF_10 = 7
-};
-
-static inline void set_input_source(InputSource source) {
+// Drive the DG408 only: the caller decides what to do with the window in progress.
+static inline void select_input(InputSource source) {
     uint8_t mask =0x70; // DG408 is connected tp PA4-PA5-PA6
     uint8_t input = static_cast<uint8_t>(source) << 4; 
     PORTA.OUT = (PORTA.OUT & ~mask) | input;
-    window_counter.reset(); // start new acquisition ASAP
+}
+
+static inline void set_input_source(InputSource source) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        select_input(acquisition.set_input_no_atomic(source));  // autozero may own the mux now
+    }
+    if (acquisition.free_running()) {
+        acquisition.restart(); // drop the window mixing the two inputs
+    } else {
+        window_counter.reset(); // start new acquisition ASAP
+    }
+}
+
+// A sequencer takes the mux over: no window may be stolen behind its back.
+static inline void take_input(InputSource source) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        acquisition.cancel_drift_window_no_atomic();
+        select_input(source);
+    }
+}
+
+// Autozero on/off: the window in progress may mix two sources, drop it.
+static inline void set_autozero(bool enable) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        select_input(acquisition.set_autozero_no_atomic(enable));
+    }
+    acquisition.restart();
 }
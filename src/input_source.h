@@ -0,0 +1,14 @@
+#pragma once
+#include <stdint.h>
+
+// DG408 channel of the integrator input, see set_input_source() in input.h
+enum class InputSource : uint8_t {
+    EXTERNAL = 0,
+    REF10 = 1,
+    REF5 = 2,
+    REF2_5 = 3,
+    REF0 = 4,
+    REF_2_5 = 5,
+    REF_5 = 6,
+    REF_10 = 7
+};
@@ -12,7 +12,38 @@
 #include "globals.hpp"
 #include "ticker.hpp"
 #include "negative_counter.hpp"
-#include "status.h"
+#include "pins.hpp"
+#include "input.h"
+#include "line_sense.h"
+
+/*
+ * Acquisition ISRs
+ *
+ * At the shortest window (PLC_0_02 at 50 Hz, 150 heartbeats = 400 us =
+ * 9600 CPU cycles) three acquisition interrupts share the CPU with the UART
+ * ones, and a UART byte at 115200 baud lasts ~2080 cycles. The acquisition
+ * handlers are therefore kept call free, so avr-gcc only saves the registers
+ * they actually use, and the hottest one is written by hand:
+ *
+ *   TCB1_INT      naked, 12 instructions (15 when the MSW low byte wraps)
+ *                 + RETI, only r24 and SREG saved
+ *   TCB3_INT      inline, no calls: autozero/drift switch + line lock trim +
+ *                 capture pairing + WindowRecord push
+ *   ADC0_RESRDY   inline, no calls: residue + WindowRecord push
+ *   ZCD1_ZCD      mains zero crossing, 50/60 times a second
+ *
+ * The two inline handlers have no cycle count here: their length depends on
+ * the compiler. Build with -DISR_TIMING to measure them on a scope:
+ * DBG_WOA (PB4) is high for the whole handler body (not usable together with
+ * heartbeat_alternative.h, which drives PB4 from TCD0).
+ */
+#ifdef ISR_TIMING
+#define ISR_TIMING_BEGIN() DBG_WOA::set()
+#define ISR_TIMING_END() DBG_WOA::clear()
+#else
+#define ISR_TIMING_BEGIN()
+#define ISR_TIMING_END()
+#endif
 
 
 ISR(RTC_PIT_vect) {
@@ -37,37 +68,58 @@ ISR(USART4_DRE_vect) {
 }
 
 
-ISR(TCB1_INT_vect) {
-	negative_counter.isr();
+// Negative counter MSW ripple, see negative_counter.hpp
+ISR(TCB1_INT_vect, ISR_NAKED) {
+	__asm__ __volatile__ (
+		"push r24"              "\n\t"
+		"in   r24, __SREG__"    "\n\t"
+		"push r24"              "\n\t"
+		"ldi  r24, %[ovf]"      "\n\t"
+		"sts  %[flags], r24"    "\n\t"  // acknowledge overflow
+		"in   r24, %[lo]"       "\n\t"
+		"inc  r24"              "\n\t"
+		"out  %[lo], r24"       "\n\t"
+		"brne 1f"               "\n\t"
+		"in   r24, %[hi]"       "\n\t"
+		"inc  r24"              "\n\t"
+		"out  %[hi], r24"       "\n"
+		"1:"                    "\n\t"
+		"pop  r24"              "\n\t"
+		"out  __SREG__, r24"    "\n\t"
+		"pop  r24"              "\n\t"
+		"reti"
+		:
+		: [ovf] "M" (TCB_OVF_bm),
+		  [flags] "n" (_SFR_MEM_ADDR(TCB1_INTFLAGS)),
+		  [lo] "I" (_SFR_IO_ADDR(NEG_COUNT_MSB_LO)),
+		  [hi] "I" (_SFR_IO_ADDR(NEG_COUNT_MSB_HI))
+	);
 }
 
 
 ISR(TCB3_INT_vect)
 {
-	window_counter.isr();
+	ISR_TIMING_BEGIN();
+	TCB3.INTFLAGS = TCB_CAPT_bm;  // Acknowledge window end
+	InputSource next;
+	if (acquisition.input_switch_from_isr(next)) {
+		select_input(next);  // as early as possible in the new window
+	}
+	const uint32_t period = window_counter.params().period;  // of the window that just ended
+	window_counter.trim_from_isr();
+	acquisition.window_complete_from_isr(negative_counter.captured_from_isr(), period);
+	ISR_TIMING_END();
 }
 
 ISR(ADC0_RESRDY_vect) {
+	ISR_TIMING_BEGIN();
 	ADC0.INTFLAGS = ADC_RESRDY_bm; // Clear interrupt flag
 	int16_t adc_result = static_cast<int16_t> (ADC0.RES); // Read ADC result to clear the conversion complete flag
-	switch (globals->status) {
-		case Status::CLEAN:
-			globals->previous_charge = adc_result;
-			globals->status = Status::PREV_CHARGE;
-			break;
-		case Status::PREV_CHARGE:
-		// todo trigger error condition to be implemented with LED
-			break;
-		case Status::NEGATIVE_COUNTS:
-			globals->charge_difference = adc_result - globals->previous_charge;
-			globals->previous_charge = adc_result;
-			globals->status = Status::RESULT_AVAIL;	
-			break;
-		case Status::RESULT_AVAIL:
-		// todo trigger error condition to be implemented with LED
-			break;
-		default:
-			break;
-	}
+	acquisition.residue_ready_from_isr(adc_result);
+	ISR_TIMING_END();
 }
 
+ISR(ZCD1_ZCD_vect) {
+	ZCD1.STATUS = ZCD_CROSSIF_bm;
+	line_monitor.zero_cross_from_isr(line_sense_timestamp());
+}
@@ -0,0 +1,123 @@
+/*
+ * line_monitor.hpp
+ *
+ * Mains period measured from the zero-cross detector, in heartbeat cycles.
+ *
+ * Created: 10/16/2026
+ *  Author: uliano
+ */
+
+#pragma once
+#include <stdint.h>
+#include <util/atomic.h>
+#include "window_length.hpp"
+
+constexpr uint8_t LINE_AVERAGE_CYCLES = 16;
+constexpr uint16_t LINE_PERIOD_MIN = HEARTBEAT_HZ / 70;  // 70 Hz
+constexpr uint16_t LINE_PERIOD_MAX = HEARTBEAT_HZ / 40;  // 40 Hz
+constexpr uint16_t LINE_TIMEOUT_MS = 1000;                // no average for this long: no mains
+
+/*
+ * Line period monitor
+ *
+ * The ZCD ISR passes the TCA1 timestamp (heartbeat cycles, modulo 2^16) of
+ * every rising zero crossing. Consecutive differences outside the 40..70 Hz
+ * range (noise, chatter, a missing cycle) restart the average; every
+ * LINE_AVERAGE_CYCLES good cycles the sum is published. The sum telescopes to
+ * the distance between the first and the last crossing, so the ISR latency
+ * jitter does not accumulate: the period is known to about 1/16 heartbeat.
+ *
+ * The superloop polls for new averages with poll() and reads them with
+ * period_x16() (heartbeats * LINE_AVERAGE_CYCLES) or frequency_mhz().
+ */
+class LineMonitor {
+private:
+    // ISR owned
+    uint16_t m_last;
+    uint32_t m_sum;
+    uint8_t m_cycles;
+    bool m_primed = false;
+
+    // Published by the ISR
+    uint32_t m_period_x16;
+    volatile uint8_t m_updates = 0;
+
+    // Superloop
+    uint8_t m_seen = 0;
+    uint32_t m_last_ms;
+    bool m_present = false;
+
+public:
+    inline void zero_cross_from_isr(uint16_t now) {
+        const uint16_t period = static_cast<uint16_t>(now - m_last);
+        m_last = now;
+        if (!m_primed) {
+            m_primed = true;
+            return;
+        }
+        if (period < LINE_PERIOD_MIN || period > LINE_PERIOD_MAX) {
+            m_sum = 0;
+            m_cycles = 0;
+            return;
+        }
+        m_sum += period;
+        if (++m_cycles < LINE_AVERAGE_CYCLES) {
+            return;
+        }
+        m_period_x16 = m_sum;
+        m_updates = m_updates + 1;
+        m_sum = 0;
+        m_cycles = 0;
+    }
+
+    // Number of averages published so far (modulo 256).
+    inline uint8_t updates(void) const {
+        return m_updates;
+    }
+
+    // Superloop: true when a new average was published since the last call.
+    inline bool poll(uint32_t now_ms) {
+        const uint8_t updates = m_updates;
+        if (updates != m_seen) {
+            m_seen = updates;
+            m_last_ms = now_ms;
+            m_present = true;
+            return true;
+        }
+        if (m_present && now_ms - m_last_ms > LINE_TIMEOUT_MS) {
+            m_present = false;
+        }
+        return false;
+    }
+
+    // A recent average exists (as of the last poll()).
+    inline bool present(void) const {
+        return m_present;
+    }
+
+    inline uint32_t period_x16(void) const {
+        uint32_t period;
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            period = m_period_x16;
+        }
+        return period;
+    }
+
+    inline uint32_t frequency_mhz(void) const {
+        const uint64_t scaled = static_cast<uint64_t>(HEARTBEAT_HZ) * 1000u * LINE_AVERAGE_CYCLES;
+        const uint32_t period = period_x16();
+        return period ? static_cast<uint32_t>((scaled + period / 2u) / period) : 0u;
+    }
+
+    // Heartbeats in `units` 1/250 of the measured line period: the line
+    // locked J of a window set in PLC.
+    inline uint32_t window_period(uint16_t units) const {
+        const uint32_t scale = static_cast<uint32_t>(WINDOW_UNITS_PER_PLC) * LINE_AVERAGE_CYCLES;
+        return static_cast<uint32_t>((static_cast<uint64_t>(period_x16()) * units + scale / 2u) / scale);
+    }
+
+    // Nominal grid closest to the last average.
+    inline GridFrequency grid_frequency(void) const {
+        return frequency_mhz() < 55000u ? GridFrequency::FREQ_50HZ : GridFrequency::FREQ_60HZ;
+    }
+};
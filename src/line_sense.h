@@ -0,0 +1,30 @@
+#pragma once
+#include <avr/io.h>
+
+/*
+ * Mains zero-cross timing.
+ *
+ * AC_SENSE (PE3) is the ZCIN1 input of ZCD1, its rising crossings interrupt.
+ * TCA1 runs free at CLK_PER / 64, the heartbeat rate of TCA0 (CLK_PER / 64
+ * through PER = 63) without depending on it, so the ZCD ISR timestamps every
+ * line cycle directly in heartbeat cycles, the unit of the window period J.
+ */
+static inline void init_line_sense(void)
+{
+    TCA1.SINGLE.CTRLA = 0;
+    TCA1.SINGLE.CTRLB = TCA_SINGLE_WGMODE_NORMAL_gc;
+    TCA1.SINGLE.PER = 0xFFFF;
+    TCA1.SINGLE.CNT = 0;
+    TCA1.SINGLE.EVCTRL = 0;
+    TCA1.SINGLE.CTRLA = TCA_SINGLE_CLKSEL_DIV64_gc | TCA_SINGLE_ENABLE_bm;
+
+    ZCD1.CTRLA = 0;
+    ZCD1.STATUS = ZCD_CROSSIF_bm;
+    ZCD1.INTCTRL = ZCD_INTMODE_RISING_gc;  // flag (and interrupt, once enabled) on rising crossings
+    ZCD1.CTRLA = ZCD_ENABLE_bm;
+}
+
+static inline uint16_t line_sense_timestamp(void)
+{
+    return TCA1.SINGLE.CNT;
+}
@@ -39,7 +39,9 @@ int main(void)
 	while (1)
 	{
 		Timer<Millis>::checkAllTimers();
+		Timer<Secs>::checkAllTimers();
 		scpi_service();
+		calibration_store.service();
 
 	}
 };
@@ -4,6 +4,10 @@
 
 
 struct Measurement {
-    uint32_t timestamp;  // ~ milliseconds, roll over in 49 days.
-    int32_t value;       
-};
\ No newline at end of file
+    uint32_t timestamp;  // ms at the window end (sample_clock.hpp), roll over in 49 days.
+    uint32_t value;      // Q0.32 fraction of the input range, see conversion.hpp
+    uint8_t flags;       // MEAS_* bits
+};
+
+constexpr uint8_t MEAS_FILLED = 0x01;         // stands in for a window stolen by drift tracking
+constexpr uint8_t MEAS_DRIFT_UPDATED = 0x02;  // first reading after the drift correction changed
\ No newline at end of file
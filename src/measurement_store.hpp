@@ -0,0 +1,167 @@
+/*
+ * measurement_store.hpp
+ *
+ * Reading buffer with implicit timestamps: segments of evenly spaced values.
+ *
+ * Created: 10/16/2026
+ *  Author: uliano
+ */
+
+#pragma once
+#include <stdint.h>
+#include "measurement.hpp"
+#include "sample_clock.hpp"
+
+constexpr uint16_t MEAS_STORE_VALUES = 2048;   // power of 2
+constexpr uint8_t MEAS_STORE_SEGMENTS = 64;    // power of 2
+
+/*
+ * Readings from first_ms + first_rest on, one every step_ms + step_rest.
+ * Times are the SampleClock ones, ms plus heartbeats (< HEARTBEATS_PER_MS),
+ * so every timestamp comes back exactly as it was stamped.
+ */
+struct MeasurementSegment {
+    uint32_t first_ms;
+    uint16_t first_rest;
+    uint16_t step_ms;
+    uint16_t step_rest;
+    uint16_t count;
+    uint8_t flags;       // MEAS_* of the first reading, the others have none
+};
+
+/*
+ * Measurement store
+ *
+ * Back to back windows give evenly spaced readings, so only the Q0.32 values
+ * are stored, 4 bytes instead of a 9 byte Measurement: the timestamps live
+ * in the segment they belong to. A reading starts a new segment when it
+ * does not fall one step after the previous one (trigger, gap, new window
+ * length) or carries flags; the second reading of a segment sets its step.
+ *
+ * When full, put() drops the oldest reading, or the whole oldest segment
+ * when all MEAS_STORE_SEGMENTS are in use, and returns how many it dropped.
+ * Superloop only, no ISR touches it.
+ */
+class MeasurementStore {
+private:
+    uint32_t m_values[MEAS_STORE_VALUES];
+    MeasurementSegment m_segments[MEAS_STORE_SEGMENTS];
+    uint16_t m_value_tail = 0;    // oldest value
+    uint16_t m_size = 0;
+    uint8_t m_segment_tail = 0;   // oldest segment
+    uint8_t m_segment_count = 0;
+    uint32_t m_last_ms;           // newest reading
+    uint16_t m_last_rest;
+
+    inline MeasurementSegment &newest(void) {
+        return m_segments[(m_segment_tail + m_segment_count - 1u) & (MEAS_STORE_SEGMENTS - 1u)];
+    }
+
+    static inline uint32_t step_of(const MeasurementSegment &segment) {
+        return static_cast<uint32_t>(segment.step_ms) * HEARTBEATS_PER_MS + segment.step_rest;
+    }
+
+    // Can the reading at (ms, rest) go at the end of the newest segment?
+    bool append(uint32_t ms, uint16_t rest) {
+        MeasurementSegment &segment = newest();
+        const uint32_t elapsed_ms = ms - m_last_ms;
+        if (elapsed_ms > 0xFFFEu) {
+            return false;
+        }
+        const int32_t step = static_cast<int32_t>(elapsed_ms * HEARTBEATS_PER_MS) + rest - m_last_rest;
+        if (step <= 0) {
+            return false;
+        }
+        if (segment.count == 1) {
+            segment.step_ms = static_cast<uint16_t>(step / HEARTBEATS_PER_MS);
+            segment.step_rest = static_cast<uint16_t>(step % HEARTBEATS_PER_MS);
+            return true;
+        }
+        return static_cast<uint32_t>(step) == step_of(segment);
+    }
+
+public:
+    static constexpr uint16_t capacity(void) {
+        return MEAS_STORE_VALUES;
+    }
+
+    inline uint16_t size(void) const {
+        return m_size;
+    }
+
+    inline uint8_t segments(void) const {
+        return m_segment_count;
+    }
+
+    // Oldest segment, as far as its readings are still stored; size() > 0.
+    inline const MeasurementSegment &oldest(void) const {
+        return m_segments[m_segment_tail];
+    }
+
+    inline uint32_t oldest_value(uint16_t i) const {
+        return m_values[(m_value_tail + i) & (MEAS_STORE_VALUES - 1u)];
+    }
+
+    // Oldest reading out, false if empty.
+    bool get(Measurement &measurement) {
+        if (!m_size) {
+            return false;
+        }
+        MeasurementSegment &segment = m_segments[m_segment_tail];
+        measurement.timestamp = segment.first_ms;
+        measurement.value = m_values[m_value_tail];
+        measurement.flags = segment.flags;
+        m_value_tail = (m_value_tail + 1u) & (MEAS_STORE_VALUES - 1u);
+        --m_size;
+        if (--segment.count == 0) {
+            m_segment_tail = (m_segment_tail + 1u) & (MEAS_STORE_SEGMENTS - 1u);
+            --m_segment_count;
+            return true;
+        }
+        segment.first_ms += segment.step_ms;
+        segment.first_rest += segment.step_rest;
+        if (segment.first_rest >= HEARTBEATS_PER_MS) {
+            segment.first_rest -= HEARTBEATS_PER_MS;
+            ++segment.first_ms;
+        }
+        segment.flags = 0;
+        return true;
+    }
+
+    /**
+     * @brief Store one reading.
+     *
+     * @param rest  heartbeats past measurement.timestamp (SampleClock::rest())
+     * @return readings dropped to make room
+     */
+    uint16_t put(const Measurement &measurement, uint16_t rest) {
+        uint16_t dropped = 0;
+        Measurement discarded;
+        if (m_size == MEAS_STORE_VALUES) {
+            get(discarded);
+            ++dropped;
+        }
+        if (!m_segment_count || measurement.flags || !append(measurement.timestamp, rest)) {
+            if (m_segment_count == MEAS_STORE_SEGMENTS) {
+                for (uint16_t n = oldest().count; n; --n) {
+                    get(discarded);
+                    ++dropped;
+                }
+            }
+            ++m_segment_count;
+            MeasurementSegment &segment = newest();
+            segment.first_ms = measurement.timestamp;
+            segment.first_rest = rest;
+            segment.step_ms = 0;
+            segment.step_rest = 0;
+            segment.count = 0;
+            segment.flags = measurement.flags;
+        }
+        ++newest().count;
+        m_values[(m_value_tail + m_size) & (MEAS_STORE_VALUES - 1u)] = measurement.value;
+        ++m_size;
+        m_last_ms = measurement.timestamp;
+        m_last_rest = rest;
+        return dropped;
+    }
+};
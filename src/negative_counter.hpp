@@ -1,6 +1,7 @@
 #pragma once
 #include <avr/io.h>
 #include <avr/interrupt.h>
+#include <util/atomic.h>
 #include "globals.hpp"
 
 union Word32 {
@@ -9,23 +10,65 @@ union Word32 {
     uint8_t bytes[4];
 };
 
+/*
+ * 32-bit negative pulse counter: TCB1 (16-bit LSW) + software MSW.
+ *
+ * TCB1 counts NEG_CLK events (channel 4) in Input Capture on Event mode:
+ * the counter runs continuously from BOTTOM to MAX and the window complete
+ * event (channel 1) copies CNT into CCMP in hardware, so the captured value
+ * is exact no matter how late the window ISR runs.
+ *
+ * The MSW is rippled by TCB1 OVF and lives in GPIOR0 (low) / GPIOR1 (high):
+ * in the low I/O space the overflow ISR updates it with IN/OUT only and needs
+ * no register but r24 (naked handler in interrupts.cpp).
+ * Pairing it with a 16-bit hardware value
+ * read later is race free as long as fewer than 65536 NEG_CLK cycles
+ * (~175 ms) elapse between the hardware event and the read:
+ *   - OVF pending and CNT in the lower half: the counter already wrapped
+ *     but TCB1_INT has not run yet -> CNT belongs to msb + 1
+ *   - captured value above CNT: the counter wrapped after the capture
+ *     -> the capture belongs to the epoch before CNT's.
+ */
+#define NEG_COUNT_MSB_LO GPIOR0
+#define NEG_COUNT_MSB_HI GPIOR1
+
 class NegativeCounter {
     private:
-        uint8_t msb;    
+        // Interrupts must be disabled.
+        static inline uint16_t msb_no_atomic(void) {
+            return static_cast<uint16_t>(NEG_COUNT_MSB_HI << 8) | NEG_COUNT_MSB_LO;
+        }
+
+        // Epoch (upper 16 bits) of the current CNT value, CNT returned in now.
+        // Interrupts must be disabled.
+        inline uint16_t epoch_no_atomic(uint16_t &now) {
+            now = TCB1.CNT;
+            uint16_t high = msb_no_atomic();
+            if ((TCB1.INTFLAGS & TCB_OVF_bm) && now < 0x8000u) {
+                ++high;
+            }
+            return high;
+        }
+
     public:
         NegativeCounter() {
             // Configure TCB1 for event counting (will trigger on negative pulse events)
-            TCB1.EVCTRL = TCB_CAPTEI_bm;  // Ensure event input is edge-qualified
+            TCB1.CTRLB = TCB_CNTMODE_CAPT_gc;  // Free running, CNT -> CCMP on capture event
+            TCB1.EVCTRL = TCB_CAPTEI_bm;  // Capture on rising edge of the window complete event
             TCB1.INTCTRL = TCB_OVF_bm;  // Enable overflow interrupt to handle MSB
-            TCB1.INTFLAGS = TCB_OVF_bm; // Clear any pending interrupt
-            TCB1.CTRLA = TCB_CLKSEL_EVENT_gc;  // EVENT mode 
+            TCB1.INTFLAGS = TCB_OVF_bm | TCB_CAPT_bm; // Clear any pending interrupt
+            TCB1.CTRLA = TCB_CLKSEL_EVENT_gc;  // EVENT mode
             reset();
-        }  
+        }
 
         inline void reset(void) {
-            TCB1.CNT = 0;
-            msb = 0;
-        }   
+            ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                TCB1.CNT = 0;
+                TCB1.INTFLAGS = TCB_OVF_bm;
+                NEG_COUNT_MSB_LO = 0;
+                NEG_COUNT_MSB_HI = 0;
+            }
+        }
 
         inline void stop(void) {
             TCB1.CTRLA &= ~TCB_ENABLE_bm;
@@ -33,19 +76,34 @@ class NegativeCounter {
 
         inline void start(void) {
             TCB1.CTRLA |= TCB_ENABLE_bm;
-        } 
-        
+        }
+
+        inline bool running(void) {
+            return TCB1.CTRLA & TCB_ENABLE_bm;
+        }
+
+        // Live count, safe from any context.
         inline int32_t get_count(void) {
             Word32 count;
-            count.words[0] = TCB1.CNT; 
-            count.bytes[2] = msb;  
+            ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                count.words[1] = epoch_no_atomic(count.words[0]);
+            }
             return count.value;
         }
 
-        inline void isr(void) {
-            TCB1.INTFLAGS = TCB_OVF_bm;  // Acknowledge overflow
-            msb += 1;
+        // Count latched by the last window complete event.
+        // Call from ISR context (interrupts disabled).
+        inline uint32_t captured_from_isr(void) {
+            Word32 count;
+            count.words[0] = TCB1.CCMP;  // also clears the CAPT flag
+            uint16_t now;
+            count.words[1] = epoch_no_atomic(now);
+            if (count.words[0] > now) {
+                count.words[1] -= 1;
+            }
+            return static_cast<uint32_t>(count.value);
         }
 
-
+        // TCB1 OVF is serviced by the naked ISR(TCB1_INT_vect) in interrupts.cpp:
+        // acknowledge the overflow and increment NEG_COUNT_MSB_HI:NEG_COUNT_MSB_LO.
 };
@@ -32,7 +32,7 @@ using DBG_NEG_CLK   = Pin<'C', 3>; // Negative count, output of LUT1
 using INT_OUT       = Pin<'D', 4>; // Analog Input for both ADC and AC1
 // PD7 VREF for ADC
 
-using AC_SENSE      = Pin<'E', 3>; // Input for ZC0
+using AC_SENSE      = Pin<'E', 3>; // ZCIN1, input of ZCD1
 
 // PF4 and PF5 UART2
 
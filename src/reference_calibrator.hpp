@@ -0,0 +1,181 @@
+/*
+ * reference_calibrator.hpp
+ *
+ * Multi-point offset/span calibration against the DG408 references.
+ *
+ * Created: 10/16/2026
+ *  Author: uliano
+ */
+
+#pragma once
+#include <stdint.h>
+#include "wide_mul.h"
+#include "input_source.h"
+
+struct ReferencePoint {
+    InputSource source;
+    int32_t microvolts;    // nominal value of the reference
+};
+
+constexpr ReferencePoint reference_points[] = {
+    { InputSource::REF_10, -10000000 },
+    { InputSource::REF_5, -5000000 },
+    { InputSource::REF_2_5, -2500000 },
+    { InputSource::REF0, 0 },
+    { InputSource::REF2_5, 2500000 },
+    { InputSource::REF5, 5000000 },
+    { InputSource::REF10, 10000000 }
+};
+
+/*
+ * Reference calibration sequencer
+ *
+ * The sequencer only does the bookkeeping, the superloop moves the input:
+ *   start(n)            then select source(), restart the acquisition and
+ *                       begin_point() with the number of stale records
+ *   feed(fraction)      for every converted record, true when the point is
+ *                       complete: if still RUNNING select the next source()
+ *                       and begin_point() again
+ * The counters are never stopped or reset between points: after each switch
+ * the records queued before it and SETTLE_WINDOWS more are discarded, then
+ * the Q0.32 fractions of the next n windows are averaged.
+ *
+ * At the end the straight line  uV = offset + span * x  is least squares
+ * fitted to the point means in fixed point:
+ *   dx = (x - mean x) in Q0.26 (|dx| < 2^26, dx^2 summed over 7 points < 2^55)
+ *   dv = uV - mean uV          (|dv| < 2^25, dx * dv summed < 2^54)
+ *   span = Sxv * 2^26 / Sxx = (Sxv * 2^8) / (Sxx >> 18)
+ * and the residual of every point is kept (uV) as a per-segment error
+ * estimate of the linear model.
+ */
+class ReferenceCalibrator {
+public:
+    static constexpr uint8_t POINT_COUNT = sizeof(reference_points) / sizeof(reference_points[0]);
+    static constexpr uint8_t SETTLE_WINDOWS = 2;
+
+    enum class State : uint8_t {
+        IDLE,
+        RUNNING,
+        DONE,
+        FAILED
+    };
+
+private:
+    uint64_t m_sum;
+    uint16_t m_count;
+    uint16_t m_windows;
+    uint16_t m_discard;
+    uint8_t m_point;
+    State m_state = State::IDLE;
+
+    uint32_t m_mean[POINT_COUNT];         // Q0.32 mean of every point
+    int32_t m_residual_uv[POINT_COUNT];   // reference - fitted reading
+    int32_t m_offset_uv;
+    int32_t m_span_uv;
+
+    inline bool fit(void) {
+        uint64_t sum_x = 0;
+        int32_t sum_v = 0;
+        for (uint8_t i = 0; i < POINT_COUNT; ++i) {
+            sum_x += m_mean[i];
+            sum_v += reference_points[i].microvolts;
+        }
+        const uint32_t mean_x = static_cast<uint32_t>((sum_x + POINT_COUNT / 2) / POINT_COUNT);
+        const int32_t mean_v = sum_v / POINT_COUNT;
+
+        int64_t sxx = 0;
+        int64_t sxv = 0;
+        for (uint8_t i = 0; i < POINT_COUNT; ++i) {
+            const int64_t dx = (static_cast<int64_t>(m_mean[i]) - mean_x) / 64;
+            const int64_t dv = reference_points[i].microvolts - mean_v;
+            sxx += dx * dx;
+            sxv += dx * dv;
+        }
+        const int64_t den = sxx >> 18;
+        if (den == 0) {
+            return false;  // all points read the same
+        }
+        const int64_t span = (sxv * 256) / den;
+        if (span <= -0x7FFFFFFFll || span >= 0x7FFFFFFFll || span == 0) {
+            return false;
+        }
+        m_span_uv = static_cast<int32_t>(span);
+        m_offset_uv = mean_v - mulhi_s32_u32(m_span_uv, mean_x);
+        for (uint8_t i = 0; i < POINT_COUNT; ++i) {
+            m_residual_uv[i] = reference_points[i].microvolts -
+                               (m_offset_uv + mulhi_s32_u32(m_span_uv, m_mean[i]));
+        }
+        return true;
+    }
+
+public:
+    // Start over n windows per point; the caller then selects source().
+    inline bool start(uint16_t windows) {
+        if (windows == 0) {
+            return false;
+        }
+        m_windows = windows;
+        m_point = 0;
+        m_state = State::RUNNING;
+        begin_point(0);
+        return true;
+    }
+
+    // The input of the current point was just selected: stale records were
+    // queued before the switch and must not be averaged.
+    inline void begin_point(uint8_t stale) {
+        m_sum = 0;
+        m_count = 0;
+        m_discard = static_cast<uint16_t>(stale) + SETTLE_WINDOWS;
+    }
+
+    // Returns true when the current point is complete.
+    inline bool feed(uint32_t fraction) {
+        if (m_state != State::RUNNING) {
+            return false;
+        }
+        if (m_discard) {
+            --m_discard;
+            return false;
+        }
+        m_sum += fraction;
+        if (++m_count < m_windows) {
+            return false;
+        }
+        m_mean[m_point] = static_cast<uint32_t>((m_sum + m_windows / 2u) / m_windows);
+        if (++m_point == POINT_COUNT) {
+            m_state = fit() ? State::DONE : State::FAILED;
+        }
+        return true;
+    }
+
+    inline State state(void) const {
+        return m_state;
+    }
+
+    inline uint8_t point(void) const {
+        return m_point;
+    }
+
+    // Input of the current point, valid while RUNNING.
+    inline InputSource source(void) const {
+        return reference_points[m_point].source;
+    }
+
+    // Fit results, valid when state() is DONE.
+    inline int32_t offset_uv(void) const {
+        return m_offset_uv;
+    }
+
+    inline int32_t span_uv(void) const {
+        return m_span_uv;
+    }
+
+    inline int32_t residual_uv(uint8_t i) const {
+        return m_residual_uv[i];
+    }
+
+    inline uint32_t mean(uint8_t i) const {
+        return m_mean[i];
+    }
+};
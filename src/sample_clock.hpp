@@ -0,0 +1,99 @@
+/*
+ * sample_clock.hpp
+ *
+ * Reading timestamps from the window index and period, anchored to the RTC.
+ *
+ * Created: 10/16/2026
+ *  Author: uliano
+ */
+
+#pragma once
+#include <stdint.h>
+#include "window_length.hpp"
+
+constexpr uint16_t HEARTBEATS_PER_MS = HEARTBEAT_HZ / 1000u;
+constexpr uint16_t SAMPLE_CLOCK_MAX_GAP = 1024;  // windows, beyond it re-anchor
+
+/*
+ * Sample clock
+ *
+ * The windows are back to back in heartbeat time, so the end of a window is
+ * the end of the previous one plus its period (the record carries the period
+ * actually counted, line lock included). Time is kept as milliseconds plus a
+ * remainder in heartbeats, so it never drifts from the window grid; the
+ * split of the period in ms + remainder is cached, so stamping consecutive
+ * windows is two additions and a compare, no division.
+ *
+ * Only the anchor comes from the RTC (Ticker::millis()): the first window
+ * after a restart gets the drain time, less the windows queued after it.
+ * Whoever restarts the acquisition calls reset() as well.
+ * The clock re-anchors when the index goes back (RESTART counting), jumps
+ * more than SAMPLE_CLOCK_MAX_GAP windows, or a gap comes with a different
+ * period (a reconfiguration: the windows missed had another length).
+ * FREE_RUNNING gaps of the same period (autozero, drift, decimation, a
+ * dropped window) keep exact timestamps.
+ */
+class SampleClock {
+private:
+    uint32_t m_ms = 0;
+    uint16_t m_rest = 0;        // heartbeats past m_ms, < HEARTBEATS_PER_MS
+    uint32_t m_index = 0;       // window stamped last
+    uint32_t m_period = 0;      // cached split of this period:
+    uint32_t m_period_ms = 0;
+    uint16_t m_period_rest = 0;
+    bool m_anchored = false;
+
+    inline void split(uint32_t period) {
+        if (period != m_period) {
+            m_period = period;
+            m_period_ms = period / HEARTBEATS_PER_MS;
+            m_period_rest = static_cast<uint16_t>(period % HEARTBEATS_PER_MS);
+        }
+    }
+
+public:
+    inline void reset(void) {
+        m_anchored = false;
+    }
+
+    // Heartbeats past the ms of the last stamp().
+    inline uint16_t rest(void) const {
+        return m_rest;
+    }
+
+    /**
+     * @brief Timestamp of the end of a window, in ms.
+     *
+     * @param index   window index of the record
+     * @param period  heartbeats in that window
+     * @param now_ms  RTC time of the drain, used only to (re)anchor
+     * @param behind  windows drained after this one in the same batch
+     */
+    uint32_t stamp(uint32_t index, uint32_t period, uint32_t now_ms, uint8_t behind) {
+        const uint32_t windows = index - m_index;
+        const bool gap = windows != 1u;
+        if (!m_anchored || windows == 0 || windows > SAMPLE_CLOCK_MAX_GAP || (gap && period != m_period)) {
+            split(period);
+            m_ms = now_ms - behind * m_period_ms;
+            m_rest = 0;
+            m_index = index;
+            m_anchored = true;
+            return m_ms;
+        }
+        split(period);
+        m_index = index;
+        if (!gap) {
+            m_ms += m_period_ms;
+            m_rest += m_period_rest;
+            if (m_rest >= HEARTBEATS_PER_MS) {
+                m_rest -= HEARTBEATS_PER_MS;
+                ++m_ms;
+            }
+            return m_ms;
+        }
+        const uint32_t rest = m_rest + windows * m_period_rest;
+        m_ms += windows * m_period_ms + rest / HEARTBEATS_PER_MS;
+        m_rest = static_cast<uint16_t>(rest % HEARTBEATS_PER_MS);
+        return m_ms;
+    }
+};
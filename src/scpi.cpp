@@ -3,12 +3,13 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
-#include <util/atomic.h>
 
 #include "globals.hpp"
 #include "input.h"
 #include "pins.hpp"
 #include "line_parser.hpp"
+#include "timer.hpp"
+#include "sample_clock.hpp"
 
 namespace {
 using ScpiParser = ScpiCommandParser<4>;
@@ -17,22 +18,60 @@ using ScpiEndpoint = StreamParserEndpoint<ScpiParser, 96>;
 using ScpiRouter = CommandRouter<4>;
 
 constexpr uint16_t SCPI_MAX_READ_COUNT = 1022;
-constexpr uint16_t SCPI_BUFFER_LIMIT = 1022;
+constexpr uint16_t SCPI_BUFFER_LIMIT = MeasurementStore::capacity();
 
 bool g_scpi_initialized = false;
 ParserHub<2> g_parser_hub;
 
 InputSource g_selected_input = InputSource::EXTERNAL;
-WindowLength g_selected_window = WindowLength::PLC_1;
+
+// INL correction in force while the last reference calibration was taken:
+// its residuals are measured on top of it. Cleared once folded into the table.
+bool g_reference_inl_pending = false;
+bool g_reference_inl_enabled = false;
+
+// Readings discarded because meas_buffer was full (monotonic).
+uint32_t g_buffer_overwrites = 0;
+
+// Unit of the readings returned by FETCH/READ (FORM:UNIT).
+enum class OutputUnit : uint8_t {
+    VOLT,        // decimal volts, microvolt resolution
+    MICROVOLT,   // integer microvolts
+    NANOVOLT     // integer nanovolts
+};
+OutputUnit g_output_unit = OutputUnit::VOLT;
 
 bool g_has_last_measurement = false;
-Measurement g_last_measurement{0u, 0};
+Measurement g_last_measurement{0u, 0u, 0u};
+
+// Last reading stored by capture_measurements(), repeated by MEAS_FILLED ones.
+// FETCH/READ overwrite g_last_measurement with the reading they return.
+bool g_has_last_stored = false;
+uint32_t g_last_stored_value = 0;
 
 // 0 means infinite/free-running acquisition.
 uint16_t g_samples_per_trigger = 0;
 uint16_t g_samples_remaining = 0;
 bool g_trigger_armed = false;
 
+// Drift tracking: one window every g_drift_period seconds (0: off), REF0 and
+// the span reference in turn. g_drift_flags marks the next stored reading.
+uint16_t g_drift_period = 0;
+bool g_drift_next_span = false;
+uint8_t g_drift_flags = 0;
+
+// Line frequency follows the measured mains (SYST:LFR:AUTO) until SYST:LFR
+// sets it by hand.
+bool g_line_auto = true;
+
+// Windows set in PLC are trimmed to the measured line period (SENS:WIND:LOCK).
+bool g_line_lock = false;
+
+// Burst in burst_samples: size, constant window period, start of its first window.
+uint16_t g_burst_size = 0;
+uint32_t g_burst_period = 0;
+uint32_t g_burst_start_ms = 0;
+
 bool g_trigger_input_inverted = false;
 bool g_trigger_output_inverted = false;
 bool g_trigger_input_pullup = false;
@@ -73,10 +112,71 @@ void scpi_reply_error(ByteStream &stream, const char *code) {
     stream_write_cstr(stream, "\n");
 }
 
+// Volts with microvolt resolution, without pulling in the float library.
+void stream_write_microvolts(ByteStream &stream, int32_t microvolts) {
+    uint32_t magnitude = static_cast<uint32_t>(microvolts);
+    if (microvolts < 0) {
+        stream_write_byte(stream, '-');
+        magnitude = 0u - magnitude;
+    }
+    stream_write_u32(stream, magnitude / 1000000u);
+    stream_write_byte(stream, '.');
+    uint32_t fraction = magnitude % 1000000u;
+    for (uint32_t digit = 100000u; digit; digit /= 10u) {
+        stream_write_byte(stream, static_cast<char>('0' + fraction / digit));
+        fraction %= digit;
+    }
+}
+
+// Integer nanovolts, microvolts * 1000 + nanovolts printed as two parts so no
+// 64-bit arithmetic is needed.
+void stream_write_nanovolts(ByteStream &stream, const Reading &reading) {
+    uint32_t magnitude_uv = static_cast<uint32_t>(reading.microvolts);
+    uint16_t magnitude_nv = reading.nanovolts;
+    if (reading.microvolts < 0) {
+        stream_write_byte(stream, '-');
+        magnitude_uv = 0u - magnitude_uv;
+        if (magnitude_nv) {  // -(uv + nv/1000) = -((|uv| - 1) + (1000 - nv)/1000)
+            --magnitude_uv;
+            magnitude_nv = static_cast<uint16_t>(1000u - magnitude_nv);
+        }
+    }
+    if (!magnitude_uv) {
+        stream_write_u32(stream, magnitude_nv);
+        return;
+    }
+    stream_write_u32(stream, magnitude_uv);
+    for (uint16_t digit = 100u; digit; digit /= 10u) {
+        stream_write_byte(stream, static_cast<char>('0' + magnitude_nv / digit));
+        magnitude_nv %= digit;
+    }
+}
+
+// Q0.32 reading in FORM:UNIT.
+void stream_write_value(ByteStream &stream, uint32_t fraction) {
+    switch (g_output_unit) {
+        case OutputUnit::MICROVOLT:
+            stream_write_i32(stream, converter.to_microvolts(fraction));
+            break;
+        case OutputUnit::NANOVOLT:
+            stream_write_nanovolts(stream, converter.to_reading(fraction));
+            break;
+        default:
+            stream_write_microvolts(stream, converter.to_microvolts(fraction));
+            break;
+    }
+}
+
+// "<timestamp>,<value in FORM:UNIT>", plus ",<MEAS_* flags>" while drift
+// tracking is on.
 void scpi_reply_measurement(ByteStream &stream, const Measurement &measurement) {
     stream_write_u32(stream, measurement.timestamp);
     stream_write_cstr(stream, ",");
-    stream_write_i32(stream, measurement.value);
+    stream_write_value(stream, measurement.value);
+    if (g_drift_period) {
+        stream_write_cstr(stream, ",");
+        stream_write_u32(stream, measurement.flags);
+    }
 }
 
 bool parse_polarity_token(const char *token, bool &inverted) {
@@ -192,91 +292,351 @@ const char *input_source_to_token(InputSource source) {
     }
 }
 
-bool parse_window_plc_token(const char *token, WindowLength &window) {
+// Decimal PLC with up to three decimals, in thousandths of a PLC.
+bool parse_milli_plc_token(const char *token, uint32_t &milli_plc) {
+    if (!token || !*token) {
+        return false;
+    }
+    uint32_t value = 0;
+    uint8_t decimals = 0;
+    bool point = false;
+    for (; *token; ++token) {
+        if (*token == '.' && !point) {
+            point = true;
+            continue;
+        }
+        if (*token < '0' || *token > '9' || value > 10000000ul || (point && ++decimals > 3)) {
+            return false;
+        }
+        value = value * 10u + static_cast<uint32_t>(*token - '0');
+    }
+    for (; decimals < 3; ++decimals) {
+        value *= 10u;
+    }
+    milli_plc = value;
+    return true;
+}
+
+bool parse_counting_mode_token(const char *token, CountingMode &mode) {
     if (!token) {
         return false;
     }
-    if (strcmp(token, "0.02") == 0) { window = WindowLength::PLC_0_02; return true; }
-    if (strcmp(token, "0.1") == 0) { window = WindowLength::PLC_0_1; return true; }
-    if (strcmp(token, "0.2") == 0) { window = WindowLength::PLC_0_2; return true; }
-    if (strcmp(token, "0.5") == 0) { window = WindowLength::PLC_0_5; return true; }
-    if (strcmp(token, "1") == 0) { window = WindowLength::PLC_1; return true; }
-    if (strcmp(token, "2") == 0) { window = WindowLength::PLC_2; return true; }
-    if (strcmp(token, "5") == 0) { window = WindowLength::PLC_5; return true; }
-    if (strcmp(token, "10") == 0) { window = WindowLength::PLC_10; return true; }
-    if (strcmp(token, "20") == 0) { window = WindowLength::PLC_20; return true; }
-    if (strcmp(token, "50") == 0) { window = WindowLength::PLC_50; return true; }
-    if (strcmp(token, "100") == 0) { window = WindowLength::PLC_100; return true; }
-    if (strcmp(token, "200") == 0) { window = WindowLength::PLC_200; return true; }
+    if (parser_command_equals(token, "RESTART") || parser_command_equals(token, "REST")) {
+        mode = CountingMode::RESTART;
+        return true;
+    }
+    if (parser_command_equals(token, "FREE") ||
+        parser_command_equals(token, "FREERUN") ||
+        parser_command_equals(token, "FREE_RUNNING")) {
+        mode = CountingMode::FREE_RUNNING;
+        return true;
+    }
     return false;
 }
 
-const char *window_plc_to_token(WindowLength window) {
-    switch (window) {
-        case WindowLength::PLC_0_02: return "0.02";
-        case WindowLength::PLC_0_1: return "0.1";
-        case WindowLength::PLC_0_2: return "0.2";
-        case WindowLength::PLC_0_5: return "0.5";
-        case WindowLength::PLC_1: return "1";
-        case WindowLength::PLC_2: return "2";
-        case WindowLength::PLC_5: return "5";
-        case WindowLength::PLC_10: return "10";
-        case WindowLength::PLC_20: return "20";
-        case WindowLength::PLC_50: return "50";
-        case WindowLength::PLC_100: return "100";
-        case WindowLength::PLC_200: return "200";
-        default: return "1";
-    }
-}
-
-void clamp_measurement_buffer() {
-    while (meas_buffer.size() >= SCPI_BUFFER_LIMIT) {
-        Measurement discarded;
-        if (!meas_buffer.get(discarded)) {
-            break;
-        }
+// Thousandths as a decimal with 3 fixed digits, e.g. a rate or a frequency.
+void stream_write_milli(ByteStream &stream, uint32_t milli) {
+    stream_write_u32(stream, milli / 1000u);
+    stream_write_byte(stream, '.');
+    uint32_t fraction = milli % 1000u;
+    for (uint32_t digit = 100u; digit; digit /= 10u) {
+        stream_write_byte(stream, static_cast<char>('0' + fraction / digit));
+        fraction %= digit;
     }
 }
 
-void capture_measurement_if_ready() {
-    if (!g_trigger_armed) {
+// Thousandths of a PLC as a decimal without trailing zeros.
+void stream_write_milli_plc(ByteStream &stream, uint32_t milli_plc) {
+    stream_write_u32(stream, milli_plc / 1000u);
+    uint32_t fraction = milli_plc % 1000u;
+    if (!fraction) {
         return;
     }
+    stream_write_byte(stream, '.');
+    for (uint32_t digit = 100u; fraction; digit /= 10u) {
+        stream_write_byte(stream, static_cast<char>('0' + fraction / digit));
+        fraction %= digit;
+    }
+}
 
-    bool has_measurement = false;
-    int32_t value = 0;
+// rest: heartbeats past measurement.timestamp, from the SampleClock that
+// stamped it.
+void store_measurement(const Measurement &measurement, uint16_t rest) {
+    g_buffer_overwrites += meas_buffer.put(measurement, rest);
+    g_last_measurement = measurement;
+    g_has_last_measurement = true;
+    g_last_stored_value = measurement.value;
+    g_has_last_stored = true;
+}
 
+// A window ending between the two resets would pair the new negative count
+// with the old snapshot: no window end until restart() has set the skip.
+void start_counters() {
     ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
-        if (globals->status == Status::RESULT_AVAIL) {
-            value = globals->negative_counts;
-            globals->status = Status::CLEAN;
-            has_measurement = true;
+        negative_counter.reset();
+        window_counter.reset();
+    }
+    negative_counter.start();
+    window_counter.start();
+}
+
+bool calibration_running() {
+    return frac_den_calibrator.state() == FracDenCalibrator::State::RUNNING ||
+           reference_calibrator.state() == ReferenceCalibrator::State::RUNNING;
+}
+
+// In RESTART mode the counters only run while someone needs windows.
+void release_counters() {
+    if (!g_trigger_armed && !acquisition.free_running() && !calibration_running() &&
+        !acquisition.burst_running()) {
+        negative_counter.stop();
+        window_counter.stop();
+    }
+}
+
+// A new calibration moves the Q0.32 domain the drift baseline refers to.
+void install_calibration(const Calibration &cal) {
+    converter.set_calibration(cal);
+    drift_tracker.reset();
+}
+
+// Background D calibration: a new D is published between two records, so no
+// window is converted with a mix.
+void calibrate_frac_den(const WindowRecord &record) {
+    if (!frac_den_calibrator.feed(record.residue)) {
+        return;
+    }
+    if (frac_den_calibrator.state() == FracDenCalibrator::State::DONE) {
+        Calibration cal = converter.calibration();
+        cal.frac_den = frac_den_calibrator.result();
+        install_calibration(cal);
+    }
+    release_counters();
+}
+
+// Reference sequencer: record i of the batch just completed a point. The next
+// reference is selected without touching the counters, the records queued
+// before the switch (the rest of the batch included) are stale.
+void calibrate_references(uint8_t i, uint32_t fraction) {
+    if (!reference_calibrator.feed(fraction)) {
+        return;
+    }
+    if (reference_calibrator.state() == ReferenceCalibrator::State::RUNNING) {
+        select_input(reference_calibrator.source());
+        const uint8_t queued = acquisition.restart();
+        sample_clock.reset();
+        reference_calibrator.begin_point(static_cast<uint8_t>(queued - (i + 1u)));
+        return;
+    }
+    if (reference_calibrator.state() == ReferenceCalibrator::State::DONE) {
+        Calibration cal = converter.calibration();
+        cal.offset_uv = reference_calibrator.offset_uv();
+        cal.span_uv = reference_calibrator.span_uv();
+        install_calibration(cal);
+    }
+    select_input(g_selected_input);
+    acquisition.restart();
+    sample_clock.reset();
+    release_counters();
+}
+
+// Timer<Secs> callback: steal the next window for a drift reference reading.
+// Only while windows flow and nobody else drives the DG408.
+void request_drift_window() {
+    if (!negative_counter.running() || acquisition.autozero() || acquisition.burst_running() ||
+        reference_calibrator.state() == ReferenceCalibrator::State::RUNNING) {
+        return;
+    }
+    if (acquisition.request_drift_window(g_drift_next_span ? DRIFT_SPAN_SOURCE : InputSource::REF0)) {
+        g_drift_next_span = !g_drift_next_span;
+    }
+}
+
+Timer<Secs> g_drift_timer(60, true, request_drift_window);
+
+// Longest window the boxcar or the sinc decimator in force can sum within
+// the conversion domain. Window changes beyond it are refused: every sum
+// would be dropped.
+uint32_t filter_period_max() {
+    uint32_t period_max = Q0_32_PERIOD_MAX;
+    if (boxcar.length()) {
+        period_max /= boxcar.length();
+    }
+    for (uint8_t s = 0; s < sinc_decimator.order(); ++s) {
+        period_max /= sinc_decimator.ratio();  // floor(floor(M / a) / b) == floor(M / (a * b))
+    }
+    return period_max;
+}
+
+// Window of units 1/250 PLC at grid_freq, in heartbeats.
+uint32_t grid_window_period(GridFrequency grid_freq, uint16_t units) {
+    return static_cast<uint32_t>(static_cast<uint8_t>(grid_freq)) * units;
+}
+
+// Line lock: the window follows the measured line period within +-1/32 of
+// its nominal length, farther is a measurement gone wrong.
+void lock_window_to_line() {
+    const uint16_t units = window_counter.grid_units();
+    if (!units) {
+        return;
+    }
+    const uint32_t nominal = grid_window_period(window_counter.grid_frequency(), units);
+    const uint32_t period = line_monitor.window_period(units);
+    if (period + nominal / 32u < nominal || period > nominal + nominal / 32u ||
+        period > filter_period_max()) {
+        return;
+    }
+    window_counter.trim_period(period);
+}
+
+// Superloop: follow the mains when it moves to the other nominal frequency
+// and, with line lock, its actual period. Averages outside 45..65 Hz are left
+// alone, and so is a running calibration.
+void track_line_frequency() {
+    const uint32_t now_ms = Ticker::ptr ? Ticker::ptr->millis() : 0u;
+    if (!line_monitor.poll(now_ms) || calibration_running() || acquisition.burst_running()) {
+        return;
+    }
+    const uint32_t frequency_mhz = line_monitor.frequency_mhz();
+    if (frequency_mhz < 45000u || frequency_mhz > 65000u) {
+        return;
+    }
+    const GridFrequency grid_freq = line_monitor.grid_frequency();
+    if (g_line_auto && grid_freq != window_counter.grid_frequency() &&
+        (grid_window_period(grid_freq, window_counter.grid_units()) > filter_period_max() ||
+         !window_counter.set_grid_frequency(grid_freq))) {
+        return;  // window too long at the new frequency: the old one stays
+    }
+    if (g_line_lock) {
+        lock_window_to_line();
+    }
+}
+
+// One more reading stored for the armed trigger, disarm when complete.
+void count_sample() {
+    if (g_samples_per_trigger == 0) {
+        return;
+    }
+    if (g_samples_remaining > 0) {
+        --g_samples_remaining;
+    }
+    if (g_samples_remaining == 0) {
+        g_trigger_armed = false;
+        release_counters();
+    }
+}
+
+// Burst complete: convert it into meas_buffer in one go, readings spaced by
+// the burst period from its start, and let the counters go.
+void finish_burst() {
+    if (!acquisition.burst_running() || acquisition.burst_count() < g_burst_size) {
+        return;
+    }
+    acquisition.stop_burst();
+    WindowRecord record{};
+    record.period = g_burst_period;
+    // The first window ends after the priming one, two periods after BURST.
+    SampleClock clock;
+    const uint32_t first_ms = g_burst_start_ms + 2u * g_burst_period / HEARTBEATS_PER_MS;
+    for (uint16_t i = 0; i < g_burst_size; ++i) {
+        record.negative_counts = burst_samples[i].negative_counts;
+        record.residue_delta = burst_samples[i].residue_delta;
+        record.index = i;
+        Measurement measurement;
+        measurement.timestamp = clock.stamp(i, g_burst_period, first_ms, 0);
+        const uint16_t rest = clock.rest();
+        measurement.value = converter.to_q0_32(record);
+        if (g_drift_period) {
+            measurement.value = drift_tracker.correct(measurement.value);
         }
+        measurement.flags = 0;
+        store_measurement(measurement, rest);
     }
+    release_counters();
+}
+
+// Input windows of a run go through the boxcar or the sinc decimator when
+// one is on; autozero sequences and calibrations keep single windows.
+bool filtered_input(const WindowRecord &record) {
+    return (boxcar.length() || sinc_decimator.order()) && g_trigger_armed &&
+           !(record.flags & (RECORD_AUTOZERO | RECORD_ZERO | RECORD_DRIFT)) &&
+           reference_calibrator.state() != ReferenceCalibrator::State::RUNNING;
+}
 
-    if (!has_measurement) {
+// Drains every window completed since the last call in one batch, so a slow
+// reply or a UART burst only delays the records instead of losing them.
+void capture_measurements() {
+    const uint8_t ready = acquisition.available();
+    if (!ready) {
         return;
     }
 
-    Measurement measurement;
-    measurement.timestamp = Ticker::ptr ? Ticker::ptr->millis() : 0u;
-    measurement.value = value;
+    const uint32_t now_ms = Ticker::ptr ? Ticker::ptr->millis() : 0u;
 
-    clamp_measurement_buffer();
-    meas_buffer.put(measurement);
-    g_last_measurement = measurement;
-    g_has_last_measurement = true;
+    for (uint8_t i = 0; i < ready; ++i) {
+        const WindowRecord &record = acquisition.peek(i);
+        calibrate_frac_den(record);
+        const bool zero = record.flags & RECORD_ZERO;
+        const bool drift = record.flags & RECORD_DRIFT;
+        if (!zero && !drift && !g_trigger_armed &&
+            reference_calibrator.state() != ReferenceCalibrator::State::RUNNING) {
+            continue;  // records past the last requested sample belong to no trigger
+        }
 
-    if (g_samples_per_trigger > 0) {
-        if (g_samples_remaining > 0) {
-            --g_samples_remaining;
+        Measurement measurement;
+        measurement.flags = 0;
+        if (filtered_input(record) && sinc_decimator.order()) {
+            WindowSum sum;
+            if (!sinc_decimator.add(record, sum)) {
+                continue;  // between two outputs, or filling after a gap
+            }
+            measurement.value = converter.to_q0_32(sum.negative_counts, sum.residue, sum.period);
+        } else if (filtered_input(record)) {
+            WindowRecord sum;
+            if (!boxcar.add(record, sum)) {
+                continue;  // filling after a gap
+            }
+            measurement.value = converter.to_q0_32(sum);
+        } else {
+            measurement.value = converter.to_q0_32(record);
+        }
+        if (zero) {
+            zero_filter.update(measurement.value);  // autozero keeps tracking between triggers
+            continue;
         }
-        if (g_samples_remaining == 0) {
-            g_trigger_armed = false;
-            negative_counter.stop();
-            window_counter.stop();
+        if (drift) {
+            if (drift_tracker.update(record.flags & RECORD_DRIFT_SPAN, measurement.value)) {
+                g_drift_flags |= MEAS_DRIFT_UPDATED;
+            }
+            if (!g_trigger_armed || !g_has_last_stored) {
+                continue;
+            }
+            // No input reading in this window: repeat the last one, so the
+            // host still gets one reading per window.
+            measurement.value = g_last_stored_value;
+            measurement.flags = MEAS_FILLED;
+        } else {
+            calibrate_references(i, measurement.value);
+            if (!g_trigger_armed) {
+                continue;
+            }
+            if (record.flags & RECORD_AUTOZERO) {
+                if (!zero_filter.valid()) {
+                    continue;  // no zero measured yet
+                }
+                measurement.value = zero_filter.correct(measurement.value, converter.zero_fraction());
+            } else if (g_drift_period) {
+                measurement.value = drift_tracker.correct(measurement.value);
+                measurement.flags = g_drift_flags;
+                g_drift_flags = 0;
+            }
         }
+        measurement.timestamp = sample_clock.stamp(record.index, record.period, now_ms,
+                                                     static_cast<uint8_t>(ready - 1u - i));
+        store_measurement(measurement, sample_clock.rest());
+        count_sample();
     }
+    acquisition.consume(ready);
 }
 
 void handle_idn(const ScpiCommand &command, ByteStream &stream) {
@@ -308,118 +668,190 @@ void handle_input(const ScpiCommand &command, ByteStream &stream) {
         scpi_reply_error(stream, "ARG");
         return;
     }
+    if (reference_calibrator.state() == ReferenceCalibrator::State::RUNNING ||
+        acquisition.burst_running()) {
+        scpi_reply_error(stream, "BUSY");  // the sequencer owns the DG408, a burst its input
+        return;
+    }
 
     set_input_source(input);
     g_selected_input = input;
     scpi_reply_ok(stream);
 }
 
+// SENS:WIND:PLC <n> accepts any multiple of 0.004 PLC (one TCB3 unit, 1/250
+// PLC) whose window fits the conversion. The query replies the PLC setting
+// (line locked or not), rounded to 0.001 for a window set in heartbeat cycles.
 void handle_window(const ScpiCommand &command, ByteStream &stream) {
     if (command.is_query) {
         if (command.argument_count != 0) {
             scpi_reply_error(stream, "ARG");
             return;
         }
-        stream_write_cstr(stream, window_plc_to_token(g_selected_window));
+        const uint32_t milli_per_unit = 1000u / WINDOW_UNITS_PER_PLC;
+        const uint32_t quantum = static_cast<uint8_t>(window_counter.grid_frequency());
+        const uint32_t period = window_counter.params().period;
+        const uint32_t milli_plc = window_counter.grid_units()
+            ? milli_per_unit * window_counter.grid_units()
+            : (2u * milli_per_unit * period / quantum + 1u) / 2u;
+        stream_write_milli_plc(stream, milli_plc);
         stream_write_cstr(stream, "\n");
         return;
     }
 
+    if (acquisition.burst_running()) {
+        scpi_reply_error(stream, "BUSY");  // the burst period must not change
+        return;
+    }
+
     if (command.argument_count != 1) {
         scpi_reply_error(stream, "ARG");
         return;
     }
 
-    WindowLength window;
-    if (!parse_window_plc_token(command.arguments[0], window)) {
+    uint32_t milli_plc = 0;
+    const uint32_t milli_per_unit = 1000u / WINDOW_UNITS_PER_PLC;
+    if (!parse_milli_plc_token(command.arguments[0], milli_plc) || milli_plc % milli_per_unit ||
+        milli_plc / milli_per_unit > 0xFFFFu ||
+        grid_window_period(window_counter.grid_frequency(),
+                           static_cast<uint16_t>(milli_plc / milli_per_unit)) > filter_period_max() ||
+        !window_counter.set_window_units(static_cast<uint16_t>(milli_plc / milli_per_unit))) {
         scpi_reply_error(stream, "ARG");
         return;
     }
-
-    window_counter.set_window_length(window);
-    g_selected_window = window;
     scpi_reply_ok(stream);
 }
 
-void handle_sample_count(const ScpiCommand &command, ByteStream &stream) {
+// SENS:WIND:LOCK ON|OFF: trim windows set in PLC to the measured line period
+// (every 16 line cycles, at a window end); OFF goes back to the nominal window.
+void handle_window_lock(const ScpiCommand &command, ByteStream &stream) {
     if (command.is_query) {
         if (command.argument_count != 0) {
             scpi_reply_error(stream, "ARG");
             return;
         }
-        if (g_samples_per_trigger == 0) {
-            stream_write_cstr(stream, "INF\n");
-            return;
-        }
-        stream_write_u32(stream, g_samples_per_trigger);
-        stream_write_cstr(stream, "\n");
+        stream_write_cstr(stream, g_line_lock ? "ON\n" : "OFF\n");
         return;
     }
 
-    if (command.argument_count != 1) {
-        scpi_reply_error(stream, "ARG");
+    if (acquisition.burst_running()) {
+        scpi_reply_error(stream, "BUSY");  // the burst period must not change
         return;
     }
 
-    const char *arg = command.arguments[0];
-    if (!arg) {
+    bool enabled = false;
+    if (command.argument_count != 1 || !parse_enable_token(command.arguments[0], enabled)) {
         scpi_reply_error(stream, "ARG");
         return;
     }
+    if (g_line_lock && !enabled && window_counter.grid_units()) {
+        window_counter.set_window_units(window_counter.grid_units());
+    }
+    g_line_lock = enabled;
+    scpi_reply_ok(stream);
+}
 
-    if (parser_command_equals(arg, "INF") || strcmp(arg, "0") == 0) {
-        g_samples_per_trigger = 0;
-        scpi_reply_ok(stream);
+// SENS:WIND:BOXC <n>|OFF: every window gives the sum of the last n, n times
+// the window must fit the conversion (the window setters keep it so).
+void handle_window_boxcar(const ScpiCommand &command, ByteStream &stream) {
+    if (command.is_query) {
+        if (command.argument_count != 0) {
+            scpi_reply_error(stream, "ARG");
+            return;
+        }
+        if (boxcar.length()) {
+            stream_write_u32(stream, boxcar.length());
+            stream_write_cstr(stream, "\n");
+        } else {
+            stream_write_cstr(stream, "OFF\n");
+        }
         return;
     }
 
-    unsigned long parsed = 0;
-    if (!parser_parse_ulong(arg, parsed, 10)) {
+    if (command.argument_count != 1) {
         scpi_reply_error(stream, "ARG");
         return;
     }
-    if (parsed == 0 || parsed > SCPI_BUFFER_LIMIT) {
+    if (parser_command_equals(command.arguments[0], "OFF")) {
+        boxcar.set_length(0);
+        scpi_reply_ok(stream);
+        return;
+    }
+    unsigned long parsed = 0;
+    if (!parser_parse_ulong(command.arguments[0], parsed, 10) || parsed < 1 || parsed > BOXCAR_MAX ||
+        parsed * window_counter.params().period > Q0_32_PERIOD_MAX) {
         scpi_reply_error(stream, "ARG");
         return;
     }
-
-    g_samples_per_trigger = static_cast<uint16_t>(parsed);
+    boxcar.set_length(static_cast<uint8_t>(parsed));
+    sinc_decimator.configure(0, 0);
     scpi_reply_ok(stream);
 }
 
-void handle_trigger_input_polarity(const ScpiCommand &command, ByteStream &stream) {
+// SENS:FILT:SINC <k>,<R>|OFF: sinc^k decimation by R of the window stream,
+// k <= SINC_ORDER_MAX, 2 <= R <= 255, R^k windows must fit the conversion
+// (the window setters keep it so).
+// Replaces the boxcar. The query replies "<k>,<R>" or OFF.
+void handle_filter_sinc(const ScpiCommand &command, ByteStream &stream) {
     if (command.is_query) {
         if (command.argument_count != 0) {
             scpi_reply_error(stream, "ARG");
             return;
         }
-        stream_write_cstr(stream, g_trigger_input_inverted ? "INV\n" : "NORM\n");
+        if (!sinc_decimator.order()) {
+            stream_write_cstr(stream, "OFF\n");
+            return;
+        }
+        stream_write_u32(stream, sinc_decimator.order());
+        stream_write_cstr(stream, ",");
+        stream_write_u32(stream, sinc_decimator.ratio());
+        stream_write_cstr(stream, "\n");
         return;
     }
 
-    if (command.argument_count != 1) {
-        scpi_reply_error(stream, "ARG");
+    if (command.argument_count == 1 && parser_command_equals(command.arguments[0], "OFF")) {
+        sinc_decimator.configure(0, 0);
+        scpi_reply_ok(stream);
         return;
     }
-
-    bool inverted = false;
-    if (!parse_polarity_token(command.arguments[0], inverted)) {
+    unsigned long order = 0;
+    unsigned long ratio = 0;
+    if (command.argument_count != 2 || !parser_parse_ulong(command.arguments[0], order, 10) ||
+        !parser_parse_ulong(command.arguments[1], ratio, 10) ||
+        order < 1 || order > SINC_ORDER_MAX || ratio < 2 || ratio > 0xFFu) {
         scpi_reply_error(stream, "ARG");
         return;
     }
-
-    g_trigger_input_inverted = inverted;
-    apply_trigger_io_config();
+    uint32_t period = window_counter.params().period;
+    for (uint8_t s = 0; s < order; ++s) {
+        period *= ratio;  // <= Q0_32_PERIOD_MAX * 255 here: cannot wrap
+        if (period > Q0_32_PERIOD_MAX) {
+            scpi_reply_error(stream, "ARG");
+            return;
+        }
+    }
+    sinc_decimator.configure(static_cast<uint8_t>(order), static_cast<uint8_t>(ratio));
+    boxcar.set_length(0);
     scpi_reply_ok(stream);
 }
 
-void handle_trigger_output_polarity(const ScpiCommand &command, ByteStream &stream) {
+// SENS:WIND:CYCL <J> sets the window in heartbeat cycles (375 kHz); J must
+// be a product of two counts of 2 .. 65536, one per window counter: any
+// prime J (e.g. 7507) is rejected, and so is a J whose only splits need a
+// count above 65536.
+void handle_window_cycles(const ScpiCommand &command, ByteStream &stream) {
     if (command.is_query) {
         if (command.argument_count != 0) {
             scpi_reply_error(stream, "ARG");
             return;
         }
-        stream_write_cstr(stream, g_trigger_output_inverted ? "INV\n" : "NORM\n");
+        stream_write_u32(stream, window_counter.params().period);
+        stream_write_cstr(stream, "\n");
+        return;
+    }
+
+    if (acquisition.burst_running()) {
+        scpi_reply_error(stream, "BUSY");  // the burst period must not change
         return;
     }
 
@@ -428,24 +860,22 @@ void handle_trigger_output_polarity(const ScpiCommand &command, ByteStream &stre
         return;
     }
 
-    bool inverted = false;
-    if (!parse_polarity_token(command.arguments[0], inverted)) {
+    unsigned long parsed = 0;
+    if (!parser_parse_ulong(command.arguments[0], parsed, 10) || parsed > filter_period_max() ||
+        !window_counter.set_window_period(static_cast<uint32_t>(parsed))) {
         scpi_reply_error(stream, "ARG");
         return;
     }
-
-    g_trigger_output_inverted = inverted;
-    apply_trigger_io_config();
     scpi_reply_ok(stream);
 }
 
-void handle_trigger_input_pullup(const ScpiCommand &command, ByteStream &stream) {
+void handle_counting_mode(const ScpiCommand &command, ByteStream &stream) {
     if (command.is_query) {
         if (command.argument_count != 0) {
             scpi_reply_error(stream, "ARG");
             return;
         }
-        stream_write_cstr(stream, g_trigger_input_pullup ? "ON\n" : "OFF\n");
+        stream_write_cstr(stream, acquisition.free_running() ? "FREE\n" : "RESTART\n");
         return;
     }
 
@@ -454,88 +884,343 @@ void handle_trigger_input_pullup(const ScpiCommand &command, ByteStream &stream)
         return;
     }
 
-    bool enabled = false;
-    if (!parse_enable_token(command.arguments[0], enabled)) {
+    CountingMode mode;
+    if (!parse_counting_mode_token(command.arguments[0], mode)) {
         scpi_reply_error(stream, "ARG");
         return;
     }
 
-    g_trigger_input_pullup = enabled;
-    apply_trigger_io_config();
+    acquisition.set_counting_mode(mode);
     scpi_reply_ok(stream);
 }
 
-void handle_trigger(const ScpiCommand &command, ByteStream &stream) {
-    if (command.is_query || command.argument_count != 0) {
+// SENS:ZERO:AUTO ON|OFF interleaves REF0 windows with the input ones.
+void handle_autozero(const ScpiCommand &command, ByteStream &stream) {
+    if (command.is_query) {
+        if (command.argument_count != 0) {
+            scpi_reply_error(stream, "ARG");
+            return;
+        }
+        stream_write_cstr(stream, acquisition.autozero() ? "ON\n" : "OFF\n");
+        return;
+    }
+
+    bool enable;
+    if (command.argument_count != 1 || !parse_enable_token(command.arguments[0], enable)) {
         scpi_reply_error(stream, "ARG");
         return;
     }
+    if (reference_calibrator.state() == ReferenceCalibrator::State::RUNNING ||
+        acquisition.burst_running()) {
+        scpi_reply_error(stream, "BUSY");  // the sequencer owns the DG408, a burst its windows
+        return;
+    }
 
-    negative_counter.reset();
-    window_counter.reset();
-    negative_counter.start();
-    window_counter.start();
-    g_trigger_armed = true;
-    g_samples_remaining = g_samples_per_trigger;
+    if (enable && !acquisition.autozero()) {
+        zero_filter.reset();
+    }
+    set_autozero(enable);
     scpi_reply_ok(stream);
 }
 
-void handle_meas_ready(const ScpiCommand &command, ByteStream &stream) {
-    if (!command.is_query || command.argument_count != 0) {
-        scpi_reply_error(stream, "ARG");
+// FORM:UNIT V|UV|NV selects decimal volts, integer microvolts or integer
+// nanovolts for the readings; all three come from integer arithmetic only.
+void handle_output_unit(const ScpiCommand &command, ByteStream &stream) {
+    if (command.is_query) {
+        if (command.argument_count != 0) {
+            scpi_reply_error(stream, "ARG");
+            return;
+        }
+        switch (g_output_unit) {
+            case OutputUnit::MICROVOLT: stream_write_cstr(stream, "UV\n"); break;
+            case OutputUnit::NANOVOLT: stream_write_cstr(stream, "NV\n"); break;
+            default: stream_write_cstr(stream, "V\n"); break;
+        }
         return;
     }
-    stream_write_cstr(stream, meas_buffer.size() ? "1\n" : "0\n");
-}
 
-void handle_meas_count(const ScpiCommand &command, ByteStream &stream) {
-    if (!command.is_query || command.argument_count != 0) {
+    if (command.argument_count != 1) {
         scpi_reply_error(stream, "ARG");
         return;
     }
-    stream_write_u32(stream, meas_buffer.size());
-    stream_write_cstr(stream, "\n");
-}
 
-void handle_meas_last(const ScpiCommand &command, ByteStream &stream) {
-    if (!command.is_query || command.argument_count != 0) {
+    if (parser_command_equals(command.arguments[0], "V")) {
+        g_output_unit = OutputUnit::VOLT;
+    } else if (parser_command_equals(command.arguments[0], "UV")) {
+        g_output_unit = OutputUnit::MICROVOLT;
+    } else if (parser_command_equals(command.arguments[0], "NV")) {
+        g_output_unit = OutputUnit::NANOVOLT;
+    } else {
         scpi_reply_error(stream, "ARG");
         return;
     }
-    if (!g_has_last_measurement) {
-        scpi_reply_error(stream, "NO_DATA");
-        return;
-    }
-    scpi_reply_measurement(stream, g_last_measurement);
-    stream_write_cstr(stream, "\n");
+    scpi_reply_ok(stream);
 }
 
-void handle_meas_read(const ScpiCommand &command, ByteStream &stream) {
-    if (!command.is_query) {
+// Readings per second: one per window, one per window pair in autozero.
+void handle_rate(const ScpiCommand &command, ByteStream &stream) {
+    if (!command.is_query || command.argument_count != 0) {
         scpi_reply_error(stream, "ARG");
         return;
     }
-    if (command.argument_count > 1) {
-        scpi_reply_error(stream, "ARG");
-        return;
+    uint32_t rate_mhz = window_counter.params().rate_mhz;
+    if (acquisition.autozero()) {
+        rate_mhz /= 2u;
+    } else if (sinc_decimator.order()) {
+        rate_mhz /= sinc_decimator.ratio();
     }
+    stream_write_milli(stream, rate_mhz);
+    stream_write_cstr(stream, "\n");
+}
 
-    uint16_t requested = 1;
-    if (command.argument_count == 1) {
-        unsigned long parsed = 0;
-        if (!parser_parse_ulong(command.arguments[0], parsed, 10)) {
+void handle_sample_count(const ScpiCommand &command, ByteStream &stream) {
+    if (command.is_query) {
+        if (command.argument_count != 0) {
             scpi_reply_error(stream, "ARG");
             return;
         }
-        if (parsed == 0 || parsed > SCPI_MAX_READ_COUNT) {
-            scpi_reply_error(stream, "ARG");
+        if (g_samples_per_trigger == 0) {
+            stream_write_cstr(stream, "INF\n");
             return;
         }
-        requested = static_cast<uint16_t>(parsed);
+        stream_write_u32(stream, g_samples_per_trigger);
+        stream_write_cstr(stream, "\n");
+        return;
     }
 
-    const uint16_t available = meas_buffer.size();
-    if (available < requested) {
+    if (command.argument_count != 1) {
+        scpi_reply_error(stream, "ARG");
+        return;
+    }
+
+    const char *arg = command.arguments[0];
+    if (!arg) {
+        scpi_reply_error(stream, "ARG");
+        return;
+    }
+
+    if (parser_command_equals(arg, "INF") || strcmp(arg, "0") == 0) {
+        g_samples_per_trigger = 0;
+        scpi_reply_ok(stream);
+        return;
+    }
+
+    unsigned long parsed = 0;
+    if (!parser_parse_ulong(arg, parsed, 10)) {
+        scpi_reply_error(stream, "ARG");
+        return;
+    }
+    if (parsed == 0 || parsed > SCPI_BUFFER_LIMIT) {
+        scpi_reply_error(stream, "ARG");
+        return;
+    }
+
+    g_samples_per_trigger = static_cast<uint16_t>(parsed);
+    scpi_reply_ok(stream);
+}
+
+void handle_trigger_input_polarity(const ScpiCommand &command, ByteStream &stream) {
+    if (command.is_query) {
+        if (command.argument_count != 0) {
+            scpi_reply_error(stream, "ARG");
+            return;
+        }
+        stream_write_cstr(stream, g_trigger_input_inverted ? "INV\n" : "NORM\n");
+        return;
+    }
+
+    if (command.argument_count != 1) {
+        scpi_reply_error(stream, "ARG");
+        return;
+    }
+
+    bool inverted = false;
+    if (!parse_polarity_token(command.arguments[0], inverted)) {
+        scpi_reply_error(stream, "ARG");
+        return;
+    }
+
+    g_trigger_input_inverted = inverted;
+    apply_trigger_io_config();
+    scpi_reply_ok(stream);
+}
+
+void handle_trigger_output_polarity(const ScpiCommand &command, ByteStream &stream) {
+    if (command.is_query) {
+        if (command.argument_count != 0) {
+            scpi_reply_error(stream, "ARG");
+            return;
+        }
+        stream_write_cstr(stream, g_trigger_output_inverted ? "INV\n" : "NORM\n");
+        return;
+    }
+
+    if (command.argument_count != 1) {
+        scpi_reply_error(stream, "ARG");
+        return;
+    }
+
+    bool inverted = false;
+    if (!parse_polarity_token(command.arguments[0], inverted)) {
+        scpi_reply_error(stream, "ARG");
+        return;
+    }
+
+    g_trigger_output_inverted = inverted;
+    apply_trigger_io_config();
+    scpi_reply_ok(stream);
+}
+
+void handle_trigger_input_pullup(const ScpiCommand &command, ByteStream &stream) {
+    if (command.is_query) {
+        if (command.argument_count != 0) {
+            scpi_reply_error(stream, "ARG");
+            return;
+        }
+        stream_write_cstr(stream, g_trigger_input_pullup ? "ON\n" : "OFF\n");
+        return;
+    }
+
+    if (command.argument_count != 1) {
+        scpi_reply_error(stream, "ARG");
+        return;
+    }
+
+    bool enabled = false;
+    if (!parse_enable_token(command.arguments[0], enabled)) {
+        scpi_reply_error(stream, "ARG");
+        return;
+    }
+
+    g_trigger_input_pullup = enabled;
+    apply_trigger_io_config();
+    scpi_reply_ok(stream);
+}
+
+void handle_trigger(const ScpiCommand &command, ByteStream &stream) {
+    if (command.is_query || command.argument_count != 0) {
+        scpi_reply_error(stream, "ARG");
+        return;
+    }
+    if (reference_calibrator.state() == ReferenceCalibrator::State::RUNNING ||
+        acquisition.burst_running()) {
+        scpi_reply_error(stream, "BUSY");
+        return;
+    }
+
+    if (acquisition.free_running() && negative_counter.running()) {
+        acquisition.restart();  // counters keep running, drop the window in progress
+        sample_clock.reset();  // every run anchors to the RTC once
+    } else {
+        start_counters();
+    }
+    g_trigger_armed = true;
+    g_samples_remaining = g_samples_per_trigger;
+    scpi_reply_ok(stream);
+}
+
+// BURST <n> stores the next n windows (n <= BURST_MAX_WINDOWS, window at most
+// 65535 heartbeats, no autozero) from the ISRs straight into RAM, then
+// converts them into the measurement buffer for FETCH. No boxcar or sinc
+// filter, no drift windows; window settings are BUSY meanwhile.
+// BURST? replies "<RUNNING|IDLE>,<windows stored>,<n>".
+void handle_burst(const ScpiCommand &command, ByteStream &stream) {
+    if (command.is_query) {
+        if (command.argument_count != 0) {
+            scpi_reply_error(stream, "ARG");
+            return;
+        }
+        const bool running = acquisition.burst_running();
+        stream_write_cstr(stream, running ? "RUNNING," : "IDLE,");
+        stream_write_u32(stream, running ? acquisition.burst_count() : g_burst_size);
+        stream_write_cstr(stream, ",");
+        stream_write_u32(stream, g_burst_size);
+        stream_write_cstr(stream, "\n");
+        return;
+    }
+
+    unsigned long parsed = 0;
+    if (command.argument_count != 1 || !parser_parse_ulong(command.arguments[0], parsed, 10) ||
+        parsed == 0 || parsed > BURST_MAX_WINDOWS || acquisition.autozero() ||
+        window_counter.params().period > 0xFFFFu) {
+        scpi_reply_error(stream, "ARG");
+        return;
+    }
+    if (reference_calibrator.state() == ReferenceCalibrator::State::RUNNING ||
+        acquisition.burst_running()) {
+        scpi_reply_error(stream, "BUSY");
+        return;
+    }
+
+    window_counter.cancel_trim();  // line lock resumes after the burst
+    g_trigger_armed = false;  // the burst replaces a run in progress
+    g_burst_size = static_cast<uint16_t>(parsed);
+    g_burst_period = window_counter.params().period;
+    g_burst_start_ms = Ticker::ptr ? Ticker::ptr->millis() : 0u;
+    acquisition.start_burst(burst_samples, g_burst_size);
+    sample_clock.reset();
+    if (!acquisition.free_running() || !negative_counter.running()) {
+        start_counters();
+    }
+    scpi_reply_ok(stream);
+}
+
+void handle_meas_ready(const ScpiCommand &command, ByteStream &stream) {
+    if (!command.is_query || command.argument_count != 0) {
+        scpi_reply_error(stream, "ARG");
+        return;
+    }
+    stream_write_cstr(stream, meas_buffer.size() ? "1\n" : "0\n");
+}
+
+void handle_meas_count(const ScpiCommand &command, ByteStream &stream) {
+    if (!command.is_query || command.argument_count != 0) {
+        scpi_reply_error(stream, "ARG");
+        return;
+    }
+    stream_write_u32(stream, meas_buffer.size());
+    stream_write_cstr(stream, "\n");
+}
+
+void handle_meas_last(const ScpiCommand &command, ByteStream &stream) {
+    if (!command.is_query || command.argument_count != 0) {
+        scpi_reply_error(stream, "ARG");
+        return;
+    }
+    if (!g_has_last_measurement) {
+        scpi_reply_error(stream, "NO_DATA");
+        return;
+    }
+    scpi_reply_measurement(stream, g_last_measurement);
+    stream_write_cstr(stream, "\n");
+}
+
+void handle_meas_read(const ScpiCommand &command, ByteStream &stream) {
+    if (!command.is_query) {
+        scpi_reply_error(stream, "ARG");
+        return;
+    }
+    if (command.argument_count > 1) {
+        scpi_reply_error(stream, "ARG");
+        return;
+    }
+
+    uint16_t requested = 1;
+    if (command.argument_count == 1) {
+        unsigned long parsed = 0;
+        if (!parser_parse_ulong(command.arguments[0], parsed, 10)) {
+            scpi_reply_error(stream, "ARG");
+            return;
+        }
+        if (parsed == 0 || parsed > SCPI_MAX_READ_COUNT) {
+            scpi_reply_error(stream, "ARG");
+            return;
+        }
+        requested = static_cast<uint16_t>(parsed);
+    }
+
+    const uint16_t available = meas_buffer.size();
+    if (available < requested) {
         scpi_reply_error(stream, "UNDERFLOW");
         return;
     }
@@ -557,6 +1242,435 @@ void handle_meas_read(const ScpiCommand &command, ByteStream &stream) {
     stream_write_cstr(stream, "\n");
 }
 
+// FETC:SEGM? [n] reads up to n readings (default and at most
+// SCPI_MAX_READ_COUNT) of the oldest segment with a single timestamp:
+// "<first ms>,<first rest>,<step>,<flags>,<count>,<value>,...", reading k at
+// first + k * step, rest and step in heartbeats (1/375 ms), flags of the
+// first reading only.
+void handle_meas_segment(const ScpiCommand &command, ByteStream &stream) {
+    if (!command.is_query || command.argument_count > 1) {
+        scpi_reply_error(stream, "ARG");
+        return;
+    }
+    uint16_t requested = SCPI_MAX_READ_COUNT;
+    if (command.argument_count == 1) {
+        unsigned long parsed = 0;
+        if (!parser_parse_ulong(command.arguments[0], parsed, 10) || parsed == 0 ||
+            parsed > SCPI_MAX_READ_COUNT) {
+            scpi_reply_error(stream, "ARG");
+            return;
+        }
+        requested = static_cast<uint16_t>(parsed);
+    }
+    if (!meas_buffer.size()) {
+        scpi_reply_error(stream, "UNDERFLOW");
+        return;
+    }
+
+    const MeasurementSegment segment = meas_buffer.oldest();
+    const uint16_t count = segment.count < requested ? segment.count : requested;
+    stream_write_u32(stream, segment.first_ms);
+    stream_write_cstr(stream, ",");
+    stream_write_u32(stream, segment.first_rest);
+    stream_write_cstr(stream, ",");
+    stream_write_u32(stream, static_cast<uint32_t>(segment.step_ms) * HEARTBEATS_PER_MS + segment.step_rest);
+    stream_write_cstr(stream, ",");
+    stream_write_u32(stream, segment.flags);
+    stream_write_cstr(stream, ",");
+    stream_write_u32(stream, count);
+    for (uint16_t i = 0; i < count; ++i) {
+        Measurement measurement;
+        meas_buffer.get(measurement);
+        g_last_measurement = measurement;
+        g_has_last_measurement = true;
+        stream_write_cstr(stream, ",");
+        stream_write_value(stream, measurement.value);
+    }
+    stream_write_cstr(stream, "\n");
+}
+
+const char *calibration_state_to_token(FracDenCalibrator::State state) {
+    switch (state) {
+        case FracDenCalibrator::State::RUNNING: return "RUNNING";
+        case FracDenCalibrator::State::DONE: return "DONE";
+        case FracDenCalibrator::State::FAILED: return "FAIL";
+        default: return "IDLE";
+    }
+}
+
+// CAL:DEN <windows> starts a background D calibration over that many windows,
+// the counters are started if idle. CAL:DEN? replies
+// "<installed D>,<IDLE|RUNNING|DONE|FAIL>,<windows remaining>".
+void handle_calibrate_frac_den(const ScpiCommand &command, ByteStream &stream) {
+    if (command.is_query) {
+        if (command.argument_count != 0) {
+            scpi_reply_error(stream, "ARG");
+            return;
+        }
+        stream_write_u32(stream, converter.calibration().frac_den);
+        stream_write_cstr(stream, ",");
+        stream_write_cstr(stream, calibration_state_to_token(frac_den_calibrator.state()));
+        stream_write_cstr(stream, ",");
+        stream_write_u32(stream, frac_den_calibrator.remaining());
+        stream_write_cstr(stream, "\n");
+        return;
+    }
+
+    if (command.argument_count != 1) {
+        scpi_reply_error(stream, "ARG");
+        return;
+    }
+    if (acquisition.burst_running()) {
+        scpi_reply_error(stream, "BUSY");  // burst windows are not queued
+        return;
+    }
+
+    unsigned long parsed = 0;
+    if (!parser_parse_ulong(command.arguments[0], parsed, 10) || parsed > 0xFFFFul ||
+        !frac_den_calibrator.start(static_cast<uint16_t>(parsed))) {
+        scpi_reply_error(stream, "ARG");
+        return;
+    }
+
+    if (!negative_counter.running()) {
+        start_counters();
+    }
+    scpi_reply_ok(stream);
+}
+
+const char *reference_state_to_token(ReferenceCalibrator::State state) {
+    switch (state) {
+        case ReferenceCalibrator::State::RUNNING: return "RUNNING";
+        case ReferenceCalibrator::State::DONE: return "DONE";
+        case ReferenceCalibrator::State::FAILED: return "FAIL";
+        default: return "IDLE";
+    }
+}
+
+// CAL:REF <windows> steps the input through every reference, averaging that
+// many windows per point, then fits and installs offset and span. The counters
+// keep running across points. CAL:REF? replies
+// "<state>,<point>,<offset V>,<span V>" with the installed calibration,
+// followed by the residual (V) of every point once DONE.
+void handle_calibrate_references(const ScpiCommand &command, ByteStream &stream) {
+    if (command.is_query) {
+        if (command.argument_count != 0) {
+            scpi_reply_error(stream, "ARG");
+            return;
+        }
+        const Calibration &cal = converter.calibration();
+        stream_write_cstr(stream, reference_state_to_token(reference_calibrator.state()));
+        stream_write_cstr(stream, ",");
+        stream_write_u32(stream, reference_calibrator.point());
+        stream_write_cstr(stream, ",");
+        stream_write_microvolts(stream, cal.offset_uv);
+        stream_write_cstr(stream, ",");
+        stream_write_microvolts(stream, cal.span_uv);
+        if (reference_calibrator.state() == ReferenceCalibrator::State::DONE) {
+            for (uint8_t i = 0; i < ReferenceCalibrator::POINT_COUNT; ++i) {
+                stream_write_cstr(stream, ",");
+                stream_write_microvolts(stream, reference_calibrator.residual_uv(i));
+            }
+        }
+        stream_write_cstr(stream, "\n");
+        return;
+    }
+
+    if (command.argument_count != 1) {
+        scpi_reply_error(stream, "ARG");
+        return;
+    }
+    if (g_trigger_armed || acquisition.autozero() || acquisition.burst_running()) {
+        scpi_reply_error(stream, "BUSY");  // readings would mix with the references
+        return;
+    }
+
+    unsigned long parsed = 0;
+    if (!parser_parse_ulong(command.arguments[0], parsed, 10) || parsed > 0xFFFFul ||
+        !reference_calibrator.start(static_cast<uint16_t>(parsed))) {
+        scpi_reply_error(stream, "ARG");
+        return;
+    }
+
+    g_reference_inl_pending = true;
+    g_reference_inl_enabled = converter.inl().enabled();
+    if (!negative_counter.running()) {
+        start_counters();
+    }
+    take_input(reference_calibrator.source());
+    reference_calibrator.begin_point(acquisition.restart());
+    sample_clock.reset();
+    scpi_reply_ok(stream);
+}
+
+// Node correction (Q0.32 LSB) expressed in microvolts with the installed span.
+int32_t inl_node_microvolts(int32_t node) {
+    const int64_t uv = (static_cast<int64_t>(node) * converter.calibration().span_uv) / 4294967296ll;
+    return static_cast<int32_t>(uv);
+}
+
+// CAL:INL ON|OFF enables the correction table, CAL:INL? replies
+// "<ON|OFF>,<node 0 V>,...,<node 16 V>", nodes evenly spaced over the range.
+void handle_calibrate_inl(const ScpiCommand &command, ByteStream &stream) {
+    if (command.is_query) {
+        if (command.argument_count != 0) {
+            scpi_reply_error(stream, "ARG");
+            return;
+        }
+        const InlTable &table = converter.inl().table();
+        stream_write_cstr(stream, converter.inl().enabled() ? "ON" : "OFF");
+        for (uint8_t i = 0; i < INL_NODES; ++i) {
+            stream_write_cstr(stream, ",");
+            stream_write_microvolts(stream, inl_node_microvolts(table.node[i]));
+        }
+        stream_write_cstr(stream, "\n");
+        return;
+    }
+
+    bool enable;
+    if (command.argument_count != 1 || !parse_enable_token(command.arguments[0], enable)) {
+        scpi_reply_error(stream, "ARG");
+        return;
+    }
+    converter.inl().enable(enable);
+    drift_tracker.reset();
+    scpi_reply_ok(stream);
+}
+
+// CAL:INL:REF folds the residuals of the last reference calibration into the
+// table and enables it. Residuals taken with the correction off replace the
+// table, taken with it on they refine it; each calibration is folded once.
+void handle_calibrate_inl_reference(const ScpiCommand &command, ByteStream &stream) {
+    if (command.is_query || command.argument_count != 0) {
+        scpi_reply_error(stream, "ARG");
+        return;
+    }
+    if (reference_calibrator.state() != ReferenceCalibrator::State::DONE || !g_reference_inl_pending) {
+        scpi_reply_error(stream, "NO_DATA");
+        return;
+    }
+
+    const int32_t span_uv = converter.calibration().span_uv;
+    uint32_t x[ReferenceCalibrator::POINT_COUNT];
+    int32_t correction[ReferenceCalibrator::POINT_COUNT];
+    for (uint8_t i = 0; i < ReferenceCalibrator::POINT_COUNT; ++i) {
+        x[i] = reference_calibrator.mean(i);
+        correction[i] = static_cast<int32_t>(
+            (static_cast<int64_t>(reference_calibrator.residual_uv(i)) * 4294967296ll) / span_uv);
+    }
+
+    InlCorrection &inl = converter.inl();
+    const InlTable previous = inl.table();
+    if (!g_reference_inl_enabled) {
+        inl.clear();
+    }
+    if (!inl.add_points(x, correction, ReferenceCalibrator::POINT_COUNT)) {
+        inl.set_table(previous);
+        scpi_reply_error(stream, "ARG");  // correction out of range
+        return;
+    }
+    g_reference_inl_pending = false;
+    inl.enable(true);
+    drift_tracker.reset();
+    scpi_reply_ok(stream);
+}
+
+// CAL:INL:CLEAR zeroes and disables the table.
+void handle_calibrate_inl_clear(const ScpiCommand &command, ByteStream &stream) {
+    if (command.is_query || command.argument_count != 0) {
+        scpi_reply_error(stream, "ARG");
+        return;
+    }
+    converter.inl().clear();
+    g_reference_inl_pending = false;
+    drift_tracker.reset();
+    scpi_reply_ok(stream);
+}
+
+// CAL:DRIFT <seconds> steals one window every that many seconds, REF0 and the
+// span reference in turn, to track offset and gain drift; CAL:DRIFT OFF stops.
+// The baseline is the first reading of each reference after the command.
+// CAL:DRIFT? replies "OFF" or "<seconds>,<offset drift V>,<gain drift ppm>".
+void handle_calibrate_drift(const ScpiCommand &command, ByteStream &stream) {
+    if (command.is_query) {
+        if (command.argument_count != 0) {
+            scpi_reply_error(stream, "ARG");
+            return;
+        }
+        if (!g_drift_period) {
+            stream_write_cstr(stream, "OFF\n");
+            return;
+        }
+        const int64_t drift_uv = (static_cast<int64_t>(drift_tracker.zero_drift()) *
+                                  converter.calibration().span_uv) / 4294967296ll;
+        // The correction undoes the drift: gain drift = 1 / gain - 1.
+        const int64_t gain_ppm = (static_cast<int64_t>(DriftTracker::GAIN_ONE) * 1000000) /
+                                 drift_tracker.gain() - 1000000;
+        stream_write_u32(stream, g_drift_period);
+        stream_write_cstr(stream, ",");
+        stream_write_microvolts(stream, static_cast<int32_t>(drift_uv));
+        stream_write_cstr(stream, ",");
+        if (gain_ppm < 0) {
+            stream_write_byte(stream, '-');
+        }
+        stream_write_u32(stream, static_cast<uint32_t>(gain_ppm < 0 ? -gain_ppm : gain_ppm));
+        stream_write_cstr(stream, "\n");
+        return;
+    }
+
+    if (command.argument_count != 1) {
+        scpi_reply_error(stream, "ARG");
+        return;
+    }
+
+    unsigned long parsed = 0;
+    if (parser_command_equals(command.arguments[0], "OFF")) {
+        parsed = 0;
+    } else if (!parser_parse_ulong(command.arguments[0], parsed, 10) || parsed > 3600ul) {
+        scpi_reply_error(stream, "ARG");
+        return;
+    }
+
+    g_drift_period = static_cast<uint16_t>(parsed);
+    g_drift_next_span = false;
+    g_drift_flags = 0;
+    drift_tracker.reset();
+    if (g_drift_period) {
+        g_drift_timer.set_period(g_drift_period);
+        g_drift_timer.start();
+    } else {
+        g_drift_timer.stop();
+    }
+    scpi_reply_ok(stream);
+}
+
+// CAL:STORE saves D, offset/span, the INL table and the line frequency to the
+// EEPROM slot not holding the newest record, written in the background.
+// CAL:STORE? replies "<VALID|NONE>,<sequence>,<WRITING|IDLE>".
+void handle_calibrate_store(const ScpiCommand &command, ByteStream &stream) {
+    if (command.is_query) {
+        if (command.argument_count != 0) {
+            scpi_reply_error(stream, "ARG");
+            return;
+        }
+        stream_write_cstr(stream, calibration_store.valid() ? "VALID," : "NONE,");
+        stream_write_u32(stream, calibration_store.sequence());
+        stream_write_cstr(stream, calibration_store.writing() ? ",WRITING\n" : ",IDLE\n");
+        return;
+    }
+
+    if (command.argument_count != 0) {
+        scpi_reply_error(stream, "ARG");
+        return;
+    }
+    const CalibrationRecord record =
+        CalibrationStore::make_record(converter, window_counter.grid_frequency());
+    if (!calibration_store.save(record)) {
+        scpi_reply_error(stream, "BUSY");  // previous record still being written
+        return;
+    }
+    scpi_reply_ok(stream);
+}
+
+// SYST:LFR 50|60 selects the line frequency the windows are multiples of
+// and turns the mains tracking off.
+void handle_line_frequency(const ScpiCommand &command, ByteStream &stream) {
+    if (command.is_query) {
+        if (command.argument_count != 0) {
+            scpi_reply_error(stream, "ARG");
+            return;
+        }
+        stream_write_cstr(stream, window_counter.grid_frequency() == GridFrequency::FREQ_60HZ ? "60\n" : "50\n");
+        return;
+    }
+
+    if (acquisition.burst_running()) {
+        scpi_reply_error(stream, "BUSY");  // the burst period must not change
+        return;
+    }
+
+    if (command.argument_count != 1) {
+        scpi_reply_error(stream, "ARG");
+        return;
+    }
+
+    GridFrequency grid_freq;
+    if (parser_command_equals(command.arguments[0], "50")) {
+        grid_freq = GridFrequency::FREQ_50HZ;
+    } else if (parser_command_equals(command.arguments[0], "60")) {
+        grid_freq = GridFrequency::FREQ_60HZ;
+    } else {
+        scpi_reply_error(stream, "ARG");
+        return;
+    }
+
+    if (grid_window_period(grid_freq, window_counter.grid_units()) > filter_period_max() ||
+        !window_counter.set_grid_frequency(grid_freq)) {
+        scpi_reply_error(stream, "ARG");  // window too long at the new frequency
+        return;
+    }
+    g_line_auto = false;
+    scpi_reply_ok(stream);
+}
+
+// SYST:LFR:AUTO ON|OFF: select the line frequency from the measured mains.
+void handle_line_frequency_auto(const ScpiCommand &command, ByteStream &stream) {
+    if (command.is_query) {
+        if (command.argument_count != 0) {
+            scpi_reply_error(stream, "ARG");
+            return;
+        }
+        stream_write_cstr(stream, g_line_auto ? "ON\n" : "OFF\n");
+        return;
+    }
+
+    bool enabled = false;
+    if (command.argument_count != 1 || !parse_enable_token(command.arguments[0], enabled)) {
+        scpi_reply_error(stream, "ARG");
+        return;
+    }
+    g_line_auto = enabled;
+    scpi_reply_ok(stream);
+}
+
+// SYST:LFR:MEAS? replies the measured mains frequency in Hz, 3 decimals, or
+// NONE when no zero crossing was averaged in the last second.
+void handle_line_frequency_measure(const ScpiCommand &command, ByteStream &stream) {
+    if (!command.is_query || command.argument_count != 0) {
+        scpi_reply_error(stream, "ARG");
+        return;
+    }
+    if (!line_monitor.present()) {
+        stream_write_cstr(stream, "NONE\n");
+        return;
+    }
+    stream_write_milli(stream, line_monitor.frequency_mhz());
+    stream_write_cstr(stream, "\n");
+}
+
+// Reply: lost windows, ISR state violations, buffer overwrites, UART TX drops.
+// All counters are monotonic since power up, so a run is lossless when two
+// readings taken before and after it are equal.
+void handle_loss(const ScpiCommand &command, ByteStream &stream) {
+    if (!command.is_query || command.argument_count != 0) {
+        scpi_reply_error(stream, "ARG");
+        return;
+    }
+    const uint32_t counters[] = {
+        acquisition.lost_windows(),
+        acquisition.isr_violations(),
+        g_buffer_overwrites,
+        usb.tx_errors() + console.tx_errors()
+    };
+    for (uint8_t i = 0; i < sizeof(counters) / sizeof(counters[0]); ++i) {
+        if (i) {
+            stream_write_cstr(stream, ",");
+        }
+        stream_write_u32(stream, counters[i]);
+    }
+    stream_write_cstr(stream, "\n");
+}
+
 void handle_unknown(ByteStream &stream) {
     scpi_reply_error(stream, "CMD");
 }
@@ -570,6 +1684,22 @@ void scpi_command_handler(const ScpiCommand &command, ByteStream &stream) {
         { "ROUT:INP", handle_input },
         { "SENSE:WINDOW:PLC", handle_window },
         { "SENS:WIND:PLC", handle_window },
+        { "SENSE:WINDOW:CYCLES", handle_window_cycles },
+        { "SENS:WIND:CYCL", handle_window_cycles },
+        { "SENSE:WINDOW:LOCK", handle_window_lock },
+        { "SENS:WIND:LOCK", handle_window_lock },
+        { "SENSE:WINDOW:BOXCAR", handle_window_boxcar },
+        { "SENS:WIND:BOXC", handle_window_boxcar },
+        { "SENSE:FILTER:SINC", handle_filter_sinc },
+        { "SENS:FILT:SINC", handle_filter_sinc },
+        { "SENSE:COUNTER:MODE", handle_counting_mode },
+        { "SENS:COUN:MODE", handle_counting_mode },
+        { "SENSE:ZERO:AUTO", handle_autozero },
+        { "SENS:ZERO:AUTO", handle_autozero },
+        { "SENSE:RATE", handle_rate },
+        { "SENS:RATE", handle_rate },
+        { "FORMAT:UNIT", handle_output_unit },
+        { "FORM:UNIT", handle_output_unit },
         { "SAMPLE:COUNT", handle_sample_count },
         { "SAMP:COUN", handle_sample_count },
         { "SAMP:COUNT", handle_sample_count },
@@ -586,15 +1716,48 @@ void scpi_command_handler(const ScpiCommand &command, ByteStream &stream) {
         { "TRIGGER:IMMEDIATE", handle_trigger },
         { "TRIG", handle_trigger },
         { "TRIG:IMM", handle_trigger },
+        { "BURST", handle_burst },
+        { "BURS", handle_burst },
 
         // Data access
         { "DATA:AVAILABLE", handle_meas_ready },
         { "DATA:POINTS", handle_meas_count },
+        { "FETCH:SEGMENT", handle_meas_segment },
+        { "FETC:SEGM", handle_meas_segment },
         { "FETCH:LAST", handle_meas_last },
         { "FETC:LAST", handle_meas_last },
         { "FETCH", handle_meas_read },
         { "FETC", handle_meas_read },
-        { "READ", handle_meas_read }
+        { "READ", handle_meas_read },
+
+        // Calibration
+        { "CALIBRATE:DENOMINATOR", handle_calibrate_frac_den },
+        { "CAL:DEN", handle_calibrate_frac_den },
+        { "CALIBRATE:REFERENCE", handle_calibrate_references },
+        { "CAL:REF", handle_calibrate_references },
+        { "CALIBRATE:INL", handle_calibrate_inl },
+        { "CAL:INL", handle_calibrate_inl },
+        { "CALIBRATE:INL:REFERENCE", handle_calibrate_inl_reference },
+        { "CAL:INL:REF", handle_calibrate_inl_reference },
+        { "CALIBRATE:INL:CLEAR", handle_calibrate_inl_clear },
+        { "CAL:INL:CLE", handle_calibrate_inl_clear },
+        { "CAL:INL:CLEAR", handle_calibrate_inl_clear },
+        { "CALIBRATE:DRIFT", handle_calibrate_drift },
+        { "CAL:DRIF", handle_calibrate_drift },
+        { "CAL:DRIFT", handle_calibrate_drift },
+        { "CALIBRATE:STORE", handle_calibrate_store },
+        { "CAL:STOR", handle_calibrate_store },
+        { "CAL:STORE", handle_calibrate_store },
+
+        // Diagnostics
+        { "SYSTEM:LOSS", handle_loss },
+        { "SYST:LOSS", handle_loss },
+        { "SYSTEM:LFREQUENCY", handle_line_frequency },
+        { "SYST:LFR", handle_line_frequency },
+        { "SYSTEM:LFREQUENCY:AUTO", handle_line_frequency_auto },
+        { "SYST:LFR:AUTO", handle_line_frequency_auto },
+        { "SYSTEM:LFREQUENCY:MEASURE", handle_line_frequency_measure },
+        { "SYST:LFR:MEAS", handle_line_frequency_measure }
     };
 
     const uint8_t route_count = static_cast<uint8_t>(sizeof(routes) / sizeof(routes[0]));
@@ -613,7 +1776,7 @@ void scpi_init() {
     g_parser_hub.add(scpi_endpoint);
 
     set_input_source(g_selected_input);
-    window_counter.set_window_length(g_selected_window);
+    window_counter.set_window_length(WindowLength::PLC_1);
     apply_trigger_io_config();
 
     g_scpi_initialized = true;
@@ -623,6 +1786,8 @@ void scpi_service() {
     if (!g_scpi_initialized) {
         return;
     }
-    capture_measurement_if_ready();
+    track_line_frequency();
+    finish_burst();
+    capture_measurements();
     g_parser_hub.service_all();
 }
@@ -0,0 +1,137 @@
+/*
+ * sinc_decimator.hpp
+ *
+ * Integer sinc^k (CIC) decimation of the raw window stream.
+ *
+ * Created: 10/16/2026
+ *  Author: uliano
+ */
+
+#pragma once
+#include <stdint.h>
+#include "acquisition.hpp"
+#include "arithmetic.h"
+
+constexpr uint8_t SINC_ORDER_MAX = 4;
+
+// Weighted sum of windows, converted by Converter::to_q0_32(counts, residue, period).
+struct WindowSum {
+    uint32_t negative_counts;
+    int32_t residue;    // sum of weighted residue differences, many D wide
+    uint32_t period;
+};
+
+/*
+ * Sinc decimator
+ *
+ * A cascade of k integrators at the window rate and k combs at 1/R of it
+ * (differential delay 1) is a sinc^k filter of k boxcars of length R: every
+ * output is a weighted sum of the last k * (R - 1) + 1 windows with integer
+ * weights adding up to R^k.
+ *
+ * It runs on the exact counts, not on readings: the negative counts, the
+ * residue differences and the periods go through the same filter, so the
+ * weighted window sums to one window of R^k times the mean period and its
+ * ratio is the filtered reading. Per window that is 3 * k 32-bit additions;
+ * the conversion and its division happen once per R windows.
+ *
+ * All stages wrap modulo 2^32 like any CIC: the wrap cancels in the combs as
+ * long as the outputs fit, R^k * J <= Q0_32_PERIOD_MAX with
+ * |residue difference| < 2^13 keeps them far from it.
+ *
+ * After reset() (and after any gap in the window index, which resets) the
+ * first k - 1 outputs see a partly empty filter and are dropped.
+ */
+class SincDecimator {
+private:
+    struct Channels {
+        uint32_t counts;
+        uint32_t period;
+        uint32_t residue;  // two's complement, wraps like the others
+    };
+
+    Channels m_integrator[SINC_ORDER_MAX];
+    Channels m_comb[SINC_ORDER_MAX];  // previous input of each comb
+    uint8_t m_order = 0;   // k, 0 when off
+    uint8_t m_ratio = 1;   // R
+    uint8_t m_phase = 0;   // windows since the last output
+    uint8_t m_outputs = 0; // outputs since reset, saturating at k
+    uint32_t m_next_index;
+
+public:
+    void reset(void) {
+        for (uint8_t s = 0; s < SINC_ORDER_MAX; ++s) {
+            m_integrator[s] = Channels{0, 0, 0};
+            m_comb[s] = Channels{0, 0, 0};
+        }
+        m_phase = 0;
+        m_outputs = 0;
+    }
+
+    // order 0 turns it off; false (nothing changed) for order > SINC_ORDER_MAX
+    // or ratio < 2.
+    bool configure(uint8_t order, uint8_t ratio) {
+        if (order > SINC_ORDER_MAX || (order && ratio < 2)) {
+            return false;
+        }
+        m_order = order;
+        m_ratio = order ? ratio : 1;
+        reset();
+        return true;
+    }
+
+    inline uint8_t order(void) const {
+        return m_order;
+    }
+
+    inline uint8_t ratio(void) const {
+        return m_ratio;
+    }
+
+    /**
+     * @brief Integrate one window, every R windows comb and decimate.
+     *
+     * @param sum  filtered window, when the return value is true
+     * @return true when an output is due, its filter is full and it fits
+     *         the Q0.32 conversion
+     */
+    bool add(const WindowRecord &record, WindowSum &sum) {
+        if (m_phase | m_outputs) {
+            if (record.index != m_next_index) {
+                reset();
+            }
+        }
+        m_next_index = record.index + 1u;
+
+        Channels x{record.negative_counts, record.period,
+                   static_cast<uint32_t>(static_cast<int32_t>(record.residue_delta))};
+        for (uint8_t s = 0; s < m_order; ++s) {
+            m_integrator[s].counts += x.counts;
+            m_integrator[s].period += x.period;
+            m_integrator[s].residue += x.residue;
+            x = m_integrator[s];
+        }
+        if (++m_phase < m_ratio) {
+            return false;
+        }
+        m_phase = 0;
+
+        for (uint8_t s = 0; s < m_order; ++s) {
+            const Channels previous = m_comb[s];
+            m_comb[s] = x;
+            x.counts -= previous.counts;
+            x.period -= previous.period;
+            x.residue -= previous.residue;
+        }
+        if (m_outputs < m_order) {
+            ++m_outputs;
+        }
+        if (m_outputs < m_order || x.period > Q0_32_PERIOD_MAX) {
+            return false;
+        }
+        sum.negative_counts = x.counts;
+        sum.residue = static_cast<int32_t>(x.residue);
+        sum.period = x.period;
+        return true;
+    }
+};
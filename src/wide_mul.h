@@ -0,0 +1,200 @@
+#pragma once
+#include <stdint.h>
+
+/*
+ * Wide multiplication kernels for the measurement arithmetic.
+ *
+ * avr-gcc widens every 64-bit product to a full 64x64 __muldi3 library call,
+ * even when both factors are known to fit in 32 bits. These kernels build the
+ * products directly from the 8x8 hardware MUL, one partial product per byte
+ * pair, with full carry propagation:
+ *
+ *   mul_u32_u32()    32 x 32 -> 64    98 cycles
+ *   mul_u32_u16()    32 x 16 -> 48    41 cycles
+ *   mulhi_s32_u32()  signed 32 x unsigned 32, upper 32 bits of the product
+ *
+ * On any other target (host builds) the plain C expressions below are the
+ * reference implementation, and the AVR versions must return bit-identical
+ * results for all inputs (test/test_wide_mul, run on the MCU).
+ *
+ * MUL leaves its result in r1:r0: r0 is the scratch register, r1 is restored
+ * to zero (__zero_reg__) before leaving each block.
+ */
+
+/**
+ * @brief Full 64-bit product of two 32-bit unsigned factors.
+ */
+static inline uint64_t mul_u32_u32(uint32_t a, uint32_t b)
+{
+#if defined(__AVR__)
+    uint32_t lo, hi;
+    uint8_t zero;
+    __asm__ (
+        "clr  %[z]"           "\n\t"
+        // byte pairs on the diagonal do not overlap: move them in place
+        "mul  %A[a], %A[b]"   "\n\t"
+        "movw %A[lo], r0"     "\n\t"
+        "mul  %B[a], %B[b]"   "\n\t"
+        "movw %C[lo], r0"     "\n\t"
+        "mul  %C[a], %C[b]"   "\n\t"
+        "movw %A[hi], r0"     "\n\t"
+        "mul  %D[a], %D[b]"   "\n\t"
+        "movw %C[hi], r0"     "\n\t"
+        // byte 1
+        "mul  %A[a], %B[b]"   "\n\t"
+        "add  %B[lo], r0"     "\n\t"
+        "adc  %C[lo], r1"     "\n\t"
+        "adc  %D[lo], %[z]"   "\n\t"
+        "adc  %A[hi], %[z]"   "\n\t"
+        "adc  %B[hi], %[z]"   "\n\t"
+        "adc  %C[hi], %[z]"   "\n\t"
+        "adc  %D[hi], %[z]"   "\n\t"
+        "mul  %B[a], %A[b]"   "\n\t"
+        "add  %B[lo], r0"     "\n\t"
+        "adc  %C[lo], r1"     "\n\t"
+        "adc  %D[lo], %[z]"   "\n\t"
+        "adc  %A[hi], %[z]"   "\n\t"
+        "adc  %B[hi], %[z]"   "\n\t"
+        "adc  %C[hi], %[z]"   "\n\t"
+        "adc  %D[hi], %[z]"   "\n\t"
+        // byte 2
+        "mul  %A[a], %C[b]"   "\n\t"
+        "add  %C[lo], r0"     "\n\t"
+        "adc  %D[lo], r1"     "\n\t"
+        "adc  %A[hi], %[z]"   "\n\t"
+        "adc  %B[hi], %[z]"   "\n\t"
+        "adc  %C[hi], %[z]"   "\n\t"
+        "adc  %D[hi], %[z]"   "\n\t"
+        "mul  %C[a], %A[b]"   "\n\t"
+        "add  %C[lo], r0"     "\n\t"
+        "adc  %D[lo], r1"     "\n\t"
+        "adc  %A[hi], %[z]"   "\n\t"
+        "adc  %B[hi], %[z]"   "\n\t"
+        "adc  %C[hi], %[z]"   "\n\t"
+        "adc  %D[hi], %[z]"   "\n\t"
+        // byte 3
+        "mul  %A[a], %D[b]"   "\n\t"
+        "add  %D[lo], r0"     "\n\t"
+        "adc  %A[hi], r1"     "\n\t"
+        "adc  %B[hi], %[z]"   "\n\t"
+        "adc  %C[hi], %[z]"   "\n\t"
+        "adc  %D[hi], %[z]"   "\n\t"
+        "mul  %D[a], %A[b]"   "\n\t"
+        "add  %D[lo], r0"     "\n\t"
+        "adc  %A[hi], r1"     "\n\t"
+        "adc  %B[hi], %[z]"   "\n\t"
+        "adc  %C[hi], %[z]"   "\n\t"
+        "adc  %D[hi], %[z]"   "\n\t"
+        "mul  %B[a], %C[b]"   "\n\t"
+        "add  %D[lo], r0"     "\n\t"
+        "adc  %A[hi], r1"     "\n\t"
+        "adc  %B[hi], %[z]"   "\n\t"
+        "adc  %C[hi], %[z]"   "\n\t"
+        "adc  %D[hi], %[z]"   "\n\t"
+        "mul  %C[a], %B[b]"   "\n\t"
+        "add  %D[lo], r0"     "\n\t"
+        "adc  %A[hi], r1"     "\n\t"
+        "adc  %B[hi], %[z]"   "\n\t"
+        "adc  %C[hi], %[z]"   "\n\t"
+        "adc  %D[hi], %[z]"   "\n\t"
+        // byte 4
+        "mul  %B[a], %D[b]"   "\n\t"
+        "add  %A[hi], r0"     "\n\t"
+        "adc  %B[hi], r1"     "\n\t"
+        "adc  %C[hi], %[z]"   "\n\t"
+        "adc  %D[hi], %[z]"   "\n\t"
+        "mul  %D[a], %B[b]"   "\n\t"
+        "add  %A[hi], r0"     "\n\t"
+        "adc  %B[hi], r1"     "\n\t"
+        "adc  %C[hi], %[z]"   "\n\t"
+        "adc  %D[hi], %[z]"   "\n\t"
+        // byte 5
+        "mul  %C[a], %D[b]"   "\n\t"
+        "add  %B[hi], r0"     "\n\t"
+        "adc  %C[hi], r1"     "\n\t"
+        "adc  %D[hi], %[z]"   "\n\t"
+        "mul  %D[a], %C[b]"   "\n\t"
+        "add  %B[hi], r0"     "\n\t"
+        "adc  %C[hi], r1"     "\n\t"
+        "adc  %D[hi], %[z]"   "\n\t"
+        "clr  __zero_reg__"
+        : [lo] "=&r" (lo), [hi] "=&r" (hi), [z] "=&r" (zero)
+        : [a] "r" (a), [b] "r" (b)
+    );
+    return ((uint64_t)hi << 32) | lo;
+#else
+    return (uint64_t)a * b;
+#endif
+}
+
+/**
+ * @brief 48-bit product of a 32-bit and a 16-bit unsigned factor.
+ */
+static inline uint64_t mul_u32_u16(uint32_t a, uint16_t b)
+{
+#if defined(__AVR__)
+    uint32_t lo;
+    uint16_t hi;
+    uint8_t zero;
+    __asm__ (
+        "clr  %[z]"           "\n\t"
+        "mul  %A[a], %A[b]"   "\n\t"
+        "movw %A[lo], r0"     "\n\t"
+        "mul  %B[a], %B[b]"   "\n\t"
+        "movw %C[lo], r0"     "\n\t"
+        "mul  %D[a], %B[b]"   "\n\t"
+        "movw %A[hi], r0"     "\n\t"
+        // byte 1
+        "mul  %B[a], %A[b]"   "\n\t"
+        "add  %B[lo], r0"     "\n\t"
+        "adc  %C[lo], r1"     "\n\t"
+        "adc  %D[lo], %[z]"   "\n\t"
+        "adc  %A[hi], %[z]"   "\n\t"
+        "adc  %B[hi], %[z]"   "\n\t"
+        "mul  %A[a], %B[b]"   "\n\t"
+        "add  %B[lo], r0"     "\n\t"
+        "adc  %C[lo], r1"     "\n\t"
+        "adc  %D[lo], %[z]"   "\n\t"
+        "adc  %A[hi], %[z]"   "\n\t"
+        "adc  %B[hi], %[z]"   "\n\t"
+        // byte 2
+        "mul  %C[a], %A[b]"   "\n\t"
+        "add  %C[lo], r0"     "\n\t"
+        "adc  %D[lo], r1"     "\n\t"
+        "adc  %A[hi], %[z]"   "\n\t"
+        "adc  %B[hi], %[z]"   "\n\t"
+        // byte 3
+        "mul  %D[a], %A[b]"   "\n\t"
+        "add  %D[lo], r0"     "\n\t"
+        "adc  %A[hi], r1"     "\n\t"
+        "adc  %B[hi], %[z]"   "\n\t"
+        "mul  %C[a], %B[b]"   "\n\t"
+        "add  %D[lo], r0"     "\n\t"
+        "adc  %A[hi], r1"     "\n\t"
+        "adc  %B[hi], %[z]"   "\n\t"
+        "clr  __zero_reg__"
+        : [lo] "=&r" (lo), [hi] "=&r" (hi), [z] "=&r" (zero)
+        : [a] "r" (a), [b] "r" (b)
+    );
+    return ((uint64_t)hi << 32) | lo;
+#else
+    return (uint64_t)a * b;
+#endif
+}
+
+/**
+ * @brief Upper 32 bits of a signed 32 x unsigned 32 product, i.e. (a * b) >> 32.
+ *
+ * With a two's complement a = ua - 2^32 * [a < 0]:
+ *     a * b = ua * b - 2^32 * b * [a < 0]
+ * so the signed result only costs a subtraction on top of the unsigned kernel.
+ * The shift rounds toward minus infinity, like >> on a negative int64_t.
+ */
+static inline int32_t mulhi_s32_u32(int32_t a, uint32_t b)
+{
+    uint32_t hi = (uint32_t)(mul_u32_u32((uint32_t)a, b) >> 32);
+    if (a < 0) {
+        hi -= b;
+    }
+    return (int32_t)hi;
+}
@@ -1,20 +1,16 @@
 #include "globals.hpp"
 
-// These functions are moved here because they access members of the struct Globals,
-// and therefore could not live in the .hpp file (forward declaration only).
-
-void WindowCounter::isr(void) {
-    TCB3.INTFLAGS = TCB_CAPT_bm;  // Acknowledge overflow
-    uint32_t timestamp = Ticker::ptr->millis();
-    globals->previous_charge = globals->charge_difference;
-    globals->charge_difference = negative_counter.get_count();
-    globals->negative_counts = negative_counter.get_count();
-    globals->status = Status::NEGATIVE_COUNTS;  // TODO to be removed once the ISR for ADC is working
-}
-
+// Moved here because it accesses the global acquisition object, whose
+// header is included after window_counter.hpp. The window end ISR is in
+// interrupts.cpp, inline, to keep it call free.
+// Atomic: the TCB3 ISR must not see the counters reset before restart()
+// has set the skip.
 void WindowCounter::reset(void) {
-    TCB0.CNT = 0;
-    TCB2.CNT = tcb2_reload;
-    TCB3.CNT = tcb3_reload;
-    globals->status = Status::CLEAN;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        TCB0.CNT = 0;
+        TCB2.CNT = params_m->tcb2_reload;
+        TCB3.CNT = params_m->tcb3_reload;
+        acquisition.restart();
+    }
+    sample_clock.reset();
 }
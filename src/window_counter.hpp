@@ -10,17 +10,9 @@
 
 #pragma once
 #include <avr/io.h>
+#include <util/atomic.h>
 #include "ticker.hpp"
-
-// Forward declaration of Globals for ISR access  
-// Note: The actual definition of Globals is in globals.hpp which includes this header, 
-// so we use a forward declaration here to avoid circular dependencies.
-// moreover, for the same reason the declaration Status has been moved to status.h 
-
-#include "status.h"
-
-struct Globals;
-extern Globals *globals;
+#include "window_length.hpp"
 
 /*
  * 32-bit Modulo-N Event Counter using cascaded TCB2+TCB3
@@ -30,8 +22,17 @@ extern Globals *globals;
  *
  * Architecture:
  *   Event -> TCB2 (16-bit LSW) -> cascade -> TCB3 (16-bit MSW) -> Overflow IRQ
- *   according to the grid frequency 50/60 Hz TCB2 counts up to respectively 25/30,
+ *   according to the grid frequency 50/60 Hz TCB2 counts up to respectively 30/25,
  *   so the window counter period will be only in multiple TCB2
+ *   Any other heartbeat count J is split as J = TCB2 count * TCB3 count by
+ *   window_split(), a J with no such split is rejected.
+ *
+ * Line lock: trim_period() queues a slightly different window (built in the
+ *   superloop in the trim slot not in use) that the TCB3 ISR switches to at
+ *   the next window end with trim_from_isr(), without resetting the counters.
+ *   The ISR is there while TCB2 counts its first prescaler period, so the new
+ *   compares take effect for the whole window that just started, and the
+ *   record of every window carries the period it was actually counted with.
  * 
  * First Cycle is special: the integrator input is disconnected to allow for the ADC 
  *   to sample without interference this is implemented by using the TCB0 set up as one-shot
@@ -42,41 +43,43 @@ extern Globals *globals;
  */
 
 
-enum class WindowLength : uint16_t {
-  PLC_0_02 = 5,
-  PLC_0_1 = 25, 
-  PLC_0_2 = 50,
-  PLC_0_5 = 125,
-  PLC_1 = 250,  
-  PLC_2 = 500,
-  PLC_5 = 1250,
-  PLC_10 = 2500,
-  PLC_20 = 5000,
-  PLC_50 = 12500,
-  PLC_100 = 25000,
-  PLC_200 = 50000
-};
-
-enum class GridFrequency : uint8_t {
-  FREQ_50HZ = 30,
-  FREQ_60HZ = 25
-};
-
 class WindowCounter {
 private:
-  uint16_t tcb2_cmp;
-  uint16_t tcb3_cmp;
-  uint16_t tcb2_reload;
-  uint16_t tcb3_reload;
-  int32_t period_m;
+  GridFrequency grid_freq_m;
+  uint16_t grid_units_m;         // length in 1/250 PLC, 0 for a plain heartbeat count
+  const WindowParams *params_m;  // entry of window_table or custom_m, never null
+  WindowParams custom_m;         // run time built window
+  WindowParams trim_m[2];        // line locked windows, see trim_period()
+  const WindowParams *volatile pending_m = nullptr;  // trim for the next window end
   TimeStamp time_m;
 
+  // The TCB3 ISR reads params_m: switch it and the compares together.
+  inline void apply_params(const WindowParams &params) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      params_m = &params;
+      pending_m = nullptr;
+      TCB2.CCMP = params.tcb2_cmp;
+      TCB3.CCMP = params.tcb3_cmp;
+    }
+    reset();
+  }
+
+  inline void apply_custom(const WindowParams &params) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      custom_m = params;
+      params_m = &custom_m;
+      pending_m = nullptr;
+      TCB2.CCMP = custom_m.tcb2_cmp;
+      TCB3.CCMP = custom_m.tcb3_cmp;
+    }
+    reset();
+  }
+
 public:
   WindowCounter(WindowLength window_length=WindowLength::PLC_1, 
                 GridFrequency grid_freq=GridFrequency::FREQ_50HZ)  {
-    tcb2_cmp = static_cast<uint16_t>(grid_freq) -1u;
-    tcb2_reload = tcb2_cmp - 1u;  // Reload to one less than compare to trigger on next count
-    set_window_length(window_length);
+    grid_freq_m = grid_freq;
+    params_m = &window_params(window_length, grid_freq);
    
     // Configure TCB0 for one-shot mode to disconnect integrator input during first cycle
     TCB0.CTRLA = TCB_CLKSEL_TCA0_gc;
@@ -99,13 +102,7 @@ public:
     TCB3.INTCTRL  = TCB_CAPT_bm;  // Enable capture interrupt on TCB3
     TCB3.INTFLAGS = TCB_CAPT_bm;  // Clear any pending interrupt
     TCB3.CTRLA = TCB_CLKSEL_EVENT_gc;  // Event mode
-    set_period();
-  }
-
-private:
-  inline void set_period(void){
-    period_m = static_cast<int32_t>(tcb2_cmp + 1u) * (static_cast<int32_t>(tcb3_cmp) + 1u);
-    reset();
+    set_window_length(window_length);
   }
 
 
@@ -123,19 +120,143 @@ public:
     TCB3.CTRLA |= TCB_ENABLE_bm;
   }
 
+  // Table lookup: compare, reload and period all come precomputed.
   inline void set_window_length(const WindowLength new_length) {
-    tcb3_cmp = static_cast<uint16_t>(new_length) -1u;
-    tcb3_reload = tcb3_cmp - 1u;  // Reload to one less than compare to trigger on next count
-    TCB3.CCMP = tcb3_cmp;
-    set_period();
+    grid_units_m = static_cast<uint16_t>(new_length);
+    apply_params(window_params(new_length, grid_freq_m));
+  }
+
+  // Any multiple of 1/250 PLC: TCB2 keeps the grid prescaler, TCB3 counts
+  // units. Table entries are used when available. False (nothing changed)
+  // if the window is too short or too long for the conversion.
+  bool set_window_units(uint16_t units) {
+    for (uint8_t l = 0; l < WINDOW_LENGTH_COUNT; ++l) {
+      if (static_cast<uint16_t>(window_lengths[l]) == units) {
+        set_window_length(window_lengths[l]);
+        return true;
+      }
+    }
+    if (units < 2) {
+      return false;
+    }
+    const WindowParams params = make_split_window_params(static_cast<uint8_t>(grid_freq_m), units);
+    if (!window_params_valid(params)) {
+      return false;
+    }
+    grid_units_m = units;
+    apply_custom(params);
+    return true;
+  }
+
+  // Any heartbeat count J, split over TCB2/TCB3; a multiple of the grid
+  // quantum keeps the PLC semantics. False (nothing changed) if J cannot be
+  // split or is out of range.
+  bool set_window_period(uint32_t period) {
+    const uint8_t quantum = static_cast<uint8_t>(grid_freq_m);
+    if (period % quantum == 0 && period / quantum <= 0xFFFFu) {
+      return set_window_units(static_cast<uint16_t>(period / quantum));
+    }
+    if (period < WINDOW_PERIOD_MIN || period > Q0_32_PERIOD_MAX) {
+      return false;
+    }
+    const uint32_t tcb2_count = window_split(period);
+    if (!tcb2_count) {
+      return false;
+    }
+    const WindowParams params = make_split_window_params(tcb2_count, period / tcb2_count);
+    if (!window_params_valid(params)) {
+      return false;
+    }
+    grid_units_m = 0;
+    apply_custom(params);
+    return true;
+  }
+
+  // Same window length in PLC, the other TCB2 prescaler; a plain heartbeat
+  // count is kept as is. False (nothing changed) if the window in PLC does
+  // not fit at the new frequency.
+  bool set_grid_frequency(const GridFrequency new_grid_freq) {
+    const GridFrequency previous = grid_freq_m;
+    grid_freq_m = new_grid_freq;
+    if (grid_units_m && !set_window_units(grid_units_m)) {
+      grid_freq_m = previous;
+      return false;
+    }
+    return true;
+  }
+
+  // Line lock: the next window (and the following ones) last about J
+  // heartbeats, the counters keep running. The PLC setting and the grid are
+  // kept, any set_*() call goes back to the nominal window. False (nothing
+  // queued) if the previous trim is still pending, J is out of range or
+  // already in force.
+  bool trim_period(uint32_t period) {
+    const WindowParams *pending;
+    const WindowParams *current;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      pending = pending_m;
+      current = params_m;
+    }
+    if (pending || period < WINDOW_PERIOD_MIN || period > Q0_32_PERIOD_MAX) {
+      return false;
+    }
+    const uint32_t tcb2_count = window_split_near(period);
+    if (!tcb2_count) {
+      return false;
+    }
+    WindowParams &slot = current == &trim_m[0] ? trim_m[1] : trim_m[0];
+    slot = make_split_window_params(tcb2_count, (period + tcb2_count / 2u) / tcb2_count);
+    if (!window_params_valid(slot) || slot.period == current->period) {
+      return false;
+    }
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      pending_m = &slot;  // two bytes: the ISR must not see half of it
+    }
+    return true;
   }
 
-  void isr(void);
+  // Keep the window in force: drop a trim not yet taken by the ISR.
+  inline void cancel_trim(void) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      pending_m = nullptr;
+    }
+  }
+
+  // TCB3 ISR, right after the window end: switch to the pending trim unless
+  // TCB2 already counted too far for its new compare (then next window end).
+  inline void trim_from_isr(void) {
+    const WindowParams *next = pending_m;
+    if (!next || TCB2.CNT + 2u > next->tcb2_cmp) {
+      return;
+    }
+    TCB2.CCMP = next->tcb2_cmp;
+    TCB3.CCMP = next->tcb3_cmp;
+    params_m = next;
+    pending_m = nullptr;
+  }
+
+  // Window length in 1/250 PLC, 0 when set as a plain heartbeat count.
+  inline uint16_t grid_units(void) const {
+    return grid_units_m;
+  }
+
+  inline GridFrequency grid_frequency(void) const {
+    return grid_freq_m;
+  }
+
+  // The TCB3 ISR may switch it to a trimmed window: read it atomically.
+  inline const WindowParams &params(void) const {
+    const WindowParams *params;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      params = params_m;
+    }
+    return *params;
+  }
 
   void reset(void);
 
   int32_t period(void) {
-    return period_m;
+    return static_cast<int32_t>(params_m->period);
   }
 };
 
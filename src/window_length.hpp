@@ -0,0 +1,236 @@
+/*
+ * window_length.hpp
+ *
+ * Integration window lengths and their compile-time parameter table.
+ *
+ * Created: 10/16/2026
+ *  Author: uliano
+ */
+
+#pragma once
+#include <stdint.h>
+#include "arithmetic.h"
+
+constexpr uint32_t HEARTBEAT_HZ = 375000;  // TCA0: CLK_PER 24 MHz / 64
+constexpr uint32_t WINDOW_PERIOD_MIN = 125;  // PLC_0_02 at 60 Hz: blanking, ADC and ISRs must fit
+constexpr uint32_t TCB_COUNT_MAX = 65536;    // 16-bit compare
+
+enum class WindowLength : uint16_t {
+  PLC_0_02 = 5,
+  PLC_0_1 = 25,
+  PLC_0_2 = 50,
+  PLC_0_5 = 125,
+  PLC_1 = 250,
+  PLC_2 = 500,
+  PLC_5 = 1250,
+  PLC_10 = 2500,
+  PLC_20 = 5000,
+  PLC_50 = 12500,
+  PLC_100 = 25000,
+  PLC_200 = 50000
+};
+
+enum class GridFrequency : uint8_t {
+  FREQ_50HZ = 30,
+  FREQ_60HZ = 25
+};
+
+// WindowLength values count units of 1/250 PLC, the TCB3 count at either
+// grid frequency.
+constexpr uint16_t WINDOW_UNITS_PER_PLC = 250;
+
+// Heartbeat cycles in one window: J of the Q0.32 conversion.
+constexpr uint32_t window_period(WindowLength length, GridFrequency grid_freq) {
+  return static_cast<uint32_t>(grid_freq) * static_cast<uint16_t>(length);
+}
+
+constexpr WindowLength window_lengths[] = {
+  WindowLength::PLC_0_02, WindowLength::PLC_0_1, WindowLength::PLC_0_2,
+  WindowLength::PLC_0_5, WindowLength::PLC_1, WindowLength::PLC_2,
+  WindowLength::PLC_5, WindowLength::PLC_10, WindowLength::PLC_20,
+  WindowLength::PLC_50, WindowLength::PLC_100, WindowLength::PLC_200
+};
+
+constexpr GridFrequency grid_frequencies[] = {
+  GridFrequency::FREQ_50HZ, GridFrequency::FREQ_60HZ
+};
+
+constexpr uint8_t WINDOW_LENGTH_COUNT = sizeof(window_lengths) / sizeof(window_lengths[0]);
+constexpr uint8_t GRID_FREQUENCY_COUNT = sizeof(grid_frequencies) / sizeof(grid_frequencies[0]);
+
+constexpr uint8_t window_length_index(WindowLength length) {
+  for (uint8_t i = 0; i < WINDOW_LENGTH_COUNT; ++i) {
+    if (window_lengths[i] == length) {
+      return i;
+    }
+  }
+  return 0;
+}
+
+constexpr uint8_t grid_frequency_index(GridFrequency grid_freq) {
+  return grid_freq == GridFrequency::FREQ_50HZ ? 0 : 1;
+}
+
+/*
+ * Everything derived from one window length at one grid frequency.
+ *
+ * The window counter is TCB2, dividing the heartbeat by the GridFrequency value
+ * (30 at 50 Hz, 25 at 60 Hz), cascaded into TCB3, counting the WindowLength
+ * value. Reload values are one less than compare so that the first event after
+ * a reset completes a count.
+ *
+ * The reciprocal is the one of J * D for the nominal D: it is used as is by the
+ * Converter until a calibration changes D.
+ *
+ * Windows outside the table (WindowCounter::set_window_units() and
+ * set_window_period()) are built at run time by the same functions and
+ * checked by the same window_params_valid().
+ */
+struct WindowParams {
+  uint32_t period;          // J, heartbeat cycles per window
+  uint16_t tcb2_cmp;
+  uint16_t tcb2_reload;
+  uint16_t tcb3_cmp;
+  uint16_t tcb3_reload;
+  uint32_t rate_mhz;        // windows per second, in mHz
+  Q032Reciprocal reciprocal;
+};
+
+// Window of tcb2_count * tcb3_count heartbeats, both counts 2 .. TCB_COUNT_MAX.
+constexpr WindowParams make_split_window_params(uint32_t tcb2_count, uint32_t tcb3_count) {
+  WindowParams p{};
+  p.period = tcb2_count * tcb3_count;
+  p.tcb2_cmp = static_cast<uint16_t>(tcb2_count - 1u);
+  p.tcb2_reload = static_cast<uint16_t>(p.tcb2_cmp - 1u);
+  p.tcb3_cmp = static_cast<uint16_t>(tcb3_count - 1u);
+  p.tcb3_reload = static_cast<uint16_t>(p.tcb3_cmp - 1u);
+  p.rate_mhz = (HEARTBEAT_HZ * 1000u + p.period / 2u) / p.period;
+  q0_32_reciprocal(&p.reciprocal, p.period, Q0_32_FRAC_DEN_NOMINAL);
+  return p;
+}
+
+// The TCB2 prescaler counts the grid quantum, TCB3 the window units.
+constexpr WindowParams make_window_params(WindowLength length, GridFrequency grid_freq) {
+  return make_split_window_params(static_cast<uint8_t>(grid_freq), static_cast<uint16_t>(length));
+}
+
+// TCB2 count for a window of J heartbeats: the smallest divisor of J from 2
+// on that leaves a TCB3 count within 16 bits, 0 if J cannot be split: every
+// prime, and e.g. 2 * a prime above TCB_COUNT_MAX. Divisors are only tried
+// up to sqrt(J), at most 1225 for Q0_32_PERIOD_MAX.
+constexpr uint32_t window_split(uint32_t period) {
+  for (uint32_t d = 2; d * d <= period; ++d) {
+    if (period % d == 0 && period / d <= TCB_COUNT_MAX) {
+      return d;
+    }
+  }
+  return 0;
+}
+
+// Line locked windows are trimmed at the window end, while TCB2 counts its
+// first prescaler period: its count must outlast the ISR latency.
+constexpr uint32_t TRIM_TCB2_MIN = 16;
+constexpr uint32_t TRIM_TCB2_MAX = 64;
+
+// TCB2 count in TRIM_TCB2_MIN .. TRIM_TCB2_MAX whose multiple (rounded TCB3
+// count) comes closest to J heartbeats, within a few heartbeats over the
+// whole window range; 0 if J is too short. Tens of divisions: superloop only.
+constexpr uint32_t window_split_near(uint32_t period) {
+  uint32_t best = 0;
+  uint32_t best_error = 0;
+  for (uint32_t d = TRIM_TCB2_MIN; d <= TRIM_TCB2_MAX && 2u * d <= period; ++d) {
+    const uint32_t count = (period + d / 2u) / d;
+    if (count > TCB_COUNT_MAX) {
+      continue;
+    }
+    const uint32_t product = d * count;
+    const uint32_t error = product > period ? product - period : period - product;
+    if (!best || error < best_error) {
+      best = d;
+      best_error = error;
+    }
+  }
+  return best;
+}
+
+struct WindowTable {
+  WindowParams entries[GRID_FREQUENCY_COUNT][WINDOW_LENGTH_COUNT];
+};
+
+constexpr WindowTable make_window_table(void) {
+  WindowTable table{};
+  for (uint8_t g = 0; g < GRID_FREQUENCY_COUNT; ++g) {
+    for (uint8_t l = 0; l < WINDOW_LENGTH_COUNT; ++l) {
+      table.entries[g][l] = make_window_params(window_lengths[l], grid_frequencies[g]);
+    }
+  }
+  return table;
+}
+
+inline constexpr WindowTable window_table = make_window_table();
+
+constexpr const WindowParams &window_params(WindowLength length, GridFrequency grid_freq) {
+  return window_table.entries[grid_frequency_index(grid_freq)][window_length_index(length)];
+}
+
+// Table entry with the given period, nullptr if no window has it.
+inline const WindowParams *find_window_params(uint32_t period) {
+  for (uint8_t g = 0; g < GRID_FREQUENCY_COUNT; ++g) {
+    for (uint8_t l = 0; l < WINDOW_LENGTH_COUNT; ++l) {
+      if (window_table.entries[g][l].period == period) {
+        return &window_table.entries[g][l];
+      }
+    }
+  }
+  return nullptr;
+}
+
+/*
+ * Build time checks of every entry:
+ * - the counters can represent it and reproduce its period
+ * - the period is long enough for the window end processing and in the
+ *   domain of pack_q0_32: WINDOW_PERIOD_MIN <= J <= Q0_32_PERIOD_MAX
+ * - the reciprocal is normalized and the rate rounds J back to the heartbeat
+ */
+constexpr bool window_params_valid(const WindowParams &p) {
+  const uint64_t dn = p.reciprocal.shift >= 0 ? p.reciprocal.denom << p.reciprocal.shift
+                                              : p.reciprocal.denom >> -p.reciprocal.shift;
+  const uint64_t heartbeat_mhz = static_cast<uint64_t>(HEARTBEAT_HZ) * 1000u;
+  const uint64_t rebuilt = static_cast<uint64_t>(p.rate_mhz) * p.period;
+  return p.period >= WINDOW_PERIOD_MIN && p.period <= Q0_32_PERIOD_MAX
+      && p.tcb2_cmp > 0 && p.tcb3_cmp > 0
+      && static_cast<uint32_t>(p.tcb2_cmp + 1u) * (p.tcb3_cmp + 1u) == p.period
+      && p.tcb2_reload == p.tcb2_cmp - 1u && p.tcb3_reload == p.tcb3_cmp - 1u
+      && p.reciprocal.J == p.period
+      && p.reciprocal.denom == static_cast<uint64_t>(p.period) * Q0_32_FRAC_DEN_NOMINAL
+      && dn >= 0x80000000u && dn <= 0xFFFFFFFFu
+      && p.reciprocal.shift >= -1
+      && rebuilt + p.period / 2u >= heartbeat_mhz && rebuilt <= heartbeat_mhz + p.period / 2u;
+}
+
+constexpr bool window_table_valid(void) {
+  for (uint8_t g = 0; g < GRID_FREQUENCY_COUNT; ++g) {
+    for (uint8_t l = 0; l < WINDOW_LENGTH_COUNT; ++l) {
+      const WindowParams &p = window_table.entries[g][l];
+      if (!window_params_valid(p) || window_length_index(window_lengths[l]) != l) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+static_assert(window_table_valid(), "window parameter table inconsistent or outside the Q0.32 domain");
+static_assert(window_params(WindowLength::PLC_1, GridFrequency::FREQ_50HZ).period == 7500,
+              "1 PLC at 50 Hz is 20 ms of heartbeat");
+static_assert(window_params(WindowLength::PLC_200, GridFrequency::FREQ_50HZ).period == Q0_32_PERIOD_MAX,
+              "longest window defines Q0_32_PERIOD_MAX");
+static_assert(window_params(WindowLength::PLC_1, GridFrequency::FREQ_60HZ).rate_mhz == 60000,
+              "1 PLC at 60 Hz is 60 windows per second");
+static_assert(window_params(WindowLength::PLC_0_02, GridFrequency::FREQ_60HZ).period == WINDOW_PERIOD_MIN,
+              "shortest window defines WINDOW_PERIOD_MIN");
+static_assert(window_split(7500) == 2 && window_split(7507) == 0 && window_split(1499977) == 0,
+              "a window splits over TCB2/TCB3 unless it has no suitable divisor");
+static_assert(window_split_near(7488) == 16 && window_split_near(WINDOW_PERIOD_MIN) != 0 &&
+              window_split_near(Q0_32_PERIOD_MAX) != 0,
+              "a trimmed window splits with a TCB2 count the window end ISR can meet");
@@ -0,0 +1,63 @@
+/*
+ * zero_filter.hpp
+ *
+ * Filtered zero of the autozero sequence.
+ *
+ * Created: 10/16/2026
+ *  Author: uliano
+ */
+
+#pragma once
+#include <stdint.h>
+
+/*
+ * First order low pass of the REF0 windows of the autozero sequence, in the
+ * Q0.32 domain: zero += (reading - zero) / 2^FILTER_SHIFT, the first reading
+ * loads the filter directly. The state keeps FILTER_SHIFT extra bits so the
+ * filter has no dead band.
+ *
+ * An input reading is corrected by replacing the filtered zero with the
+ * fraction that the calibration maps to 0 uV, so the offset drift cancels
+ * and the result still goes through the normal calibration at output.
+ */
+class ZeroFilter {
+public:
+    static constexpr uint8_t FILTER_SHIFT = 3;
+
+private:
+    uint64_t m_state;    // filtered zero << FILTER_SHIFT
+    bool m_valid;
+
+public:
+    inline void reset(void) {
+        m_valid = false;
+    }
+
+    inline void update(uint32_t zero) {
+        if (!m_valid) {
+            m_state = static_cast<uint64_t>(zero) << FILTER_SHIFT;
+            m_valid = true;
+            return;
+        }
+        m_state = m_state - (m_state >> FILTER_SHIFT) + zero;
+    }
+
+    inline bool valid(void) const {
+        return m_valid;
+    }
+
+    inline uint32_t zero(void) const {
+        return static_cast<uint32_t>(m_state >> FILTER_SHIFT);
+    }
+
+    inline uint32_t correct(uint32_t fraction, uint32_t zero_fraction) const {
+        const int64_t corrected = static_cast<int64_t>(fraction) - zero() + zero_fraction;
+        if (corrected < 0) {
+            return 0;
+        }
+        if (corrected > 0xFFFFFFFFll) {
+            return 0xFFFFFFFFu;
+        }
+        return static_cast<uint32_t>(corrected);
+    }
+};
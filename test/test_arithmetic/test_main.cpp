@@ -0,0 +1,167 @@
+/*
+ * test_main.cpp
+ *
+ * Host test of arithmetic.h, compiled unchanged (pio test -e native):
+ * pack_q0_32() and pack_q0_32_fast() against a 128-bit reference on boundary
+ * and random inputs, for every tabulated window period and for random run-time
+ * ones, then the conversion throughput of the host.
+ *
+ * Created: 10/16/2026
+ *  Author: uliano
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <chrono>
+#include <unity.h>
+#include "arithmetic.h"
+#include "window_length.hpp"
+
+namespace {
+
+constexpr uint32_t RANDOM_CASES_PER_PERIOD = 20000;
+constexpr uint32_t RANDOM_PERIODS = 2000;
+constexpr uint32_t THROUGHPUT_CASES = 20000000;
+
+constexpr uint16_t frac_dens[] = {
+    Q0_32_FRAC_DEN_MIN, Q0_32_FRAC_DEN_NOMINAL, Q0_32_FRAC_DEN_MAX
+};
+
+uint32_t g_random = 0x9E3779B9u;
+
+// xorshift32: same sequence on every run, so a failure can be replayed.
+uint32_t next_random(void) {
+    g_random ^= g_random << 13;
+    g_random ^= g_random >> 17;
+    g_random ^= g_random << 5;
+    return g_random;
+}
+
+uint32_t random_below(uint32_t n) {
+    return static_cast<uint32_t>((static_cast<uint64_t>(next_random()) * n) >> 32);
+}
+
+// round((I + K/D) / J * 2^32), saturated to 0xFFFFFFFF when I + K/D >= J.
+uint32_t reference(uint32_t I, uint16_t K, uint32_t J, uint16_t D) {
+    const unsigned __int128 denom = static_cast<unsigned __int128>(J) * D;
+    const unsigned __int128 numer = static_cast<unsigned __int128>(I) * D + K;
+    if (numer >= denom) {
+        return 0xFFFFFFFFu;
+    }
+    const unsigned __int128 x = ((numer << 32) + denom / 2u) / denom;
+    TEST_ASSERT_TRUE(x <= 0xFFFFFFFFu);
+    return static_cast<uint32_t>(x);
+}
+
+void check(uint32_t I, uint16_t K, const Q032Reciprocal &r) {
+    const uint32_t expected = reference(I, K, r.J, r.D);
+    TEST_ASSERT_EQUAL_HEX32(expected, pack_q0_32(I, K, r.J, r.D));
+    TEST_ASSERT_EQUAL_HEX32(expected, pack_q0_32_fast(I, K, &r));
+}
+
+// Domain corners, the saturation edge and random I, K < D.
+void check_period(const Q032Reciprocal &r, uint32_t random_cases) {
+    const uint32_t J = r.J;
+    const uint16_t D = r.D;
+    check(0, 0, r);
+    check(0, 1, r);
+    check(0, static_cast<uint16_t>(D - 1u), r);
+    check(J / 2u, static_cast<uint16_t>(D / 2u), r);
+    check(J - 1u, 0, r);
+    check(J - 1u, static_cast<uint16_t>(D - 1u), r);
+    check(J, 0, r);
+    for (uint32_t n = 0; n < random_cases; ++n) {
+        check(random_below(J), static_cast<uint16_t>(random_below(D)), r);
+    }
+}
+
+void test_tabulated_periods(void) {
+    for (GridFrequency grid_freq : grid_frequencies) {
+        for (WindowLength length : window_lengths) {
+            const WindowParams &params = window_params(length, grid_freq);
+            check_period(params.reciprocal, RANDOM_CASES_PER_PERIOD);
+            for (uint16_t D : frac_dens) {
+                Q032Reciprocal r;
+                q0_32_reciprocal(&r, params.period, D);
+                check_period(r, RANDOM_CASES_PER_PERIOD);
+            }
+        }
+    }
+}
+
+// set_window_period() accepts any J in the domain.
+void test_run_time_periods(void) {
+    constexpr uint32_t edges[] = {
+        WINDOW_PERIOD_MIN, 0x7FFFFFFFu / Q0_32_FRAC_DEN_MAX, 0xFFFFFFFFu / Q0_32_FRAC_DEN_MAX,
+        0xFFFFFFFFu / Q0_32_FRAC_DEN_MAX + 1u, Q0_32_PERIOD_MAX
+    };
+    for (uint32_t J : edges) {
+        for (uint16_t D : frac_dens) {
+            Q032Reciprocal r;
+            q0_32_reciprocal(&r, J, D);
+            check_period(r, RANDOM_CASES_PER_PERIOD);
+        }
+    }
+    for (uint32_t n = 0; n < RANDOM_PERIODS; ++n) {
+        const uint32_t J = WINDOW_PERIOD_MIN + random_below(Q0_32_PERIOD_MAX - WINDOW_PERIOD_MIN + 1u);
+        const uint16_t D = static_cast<uint16_t>(
+            Q0_32_FRAC_DEN_MIN + random_below(Q0_32_FRAC_DEN_MAX - Q0_32_FRAC_DEN_MIN + 1u));
+        Q032Reciprocal r;
+        q0_32_reciprocal(&r, J, D);
+        check_period(r, RANDOM_CASES_PER_PERIOD / 10u);
+    }
+}
+
+// Read at run time, so the compiler cannot fold J * D into the divisions.
+volatile uint32_t g_throughput_period = window_period(WindowLength::PLC_1, GridFrequency::FREQ_50HZ);
+
+template <typename Convert>
+void report_throughput(const char *name, Convert convert) {
+    Q032Reciprocal r;
+    q0_32_reciprocal(&r, g_throughput_period, Q0_32_FRAC_DEN_NOMINAL);
+    uint32_t I = 0;
+    uint16_t K = 0;
+    uint32_t sum = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (uint32_t n = 0; n < THROUGHPUT_CASES; ++n) {
+        sum += convert(I, K, r);
+        I += 7919u;
+        if (I >= r.J) {
+            I -= r.J;
+        }
+        K = static_cast<uint16_t>(K + 1009u);
+        if (K >= r.D) {
+            K = static_cast<uint16_t>(K - r.D);
+        }
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    char message[96];
+    snprintf(message, sizeof(message), "%s: %.1f M conversions/s (checksum %08x)",
+             name, THROUGHPUT_CASES / elapsed.count() / 1e6, static_cast<unsigned>(sum));
+    TEST_MESSAGE(message);
+}
+
+void test_throughput(void) {
+    report_throughput("pack_q0_32", [](uint32_t I, uint16_t K, const Q032Reciprocal &r) {
+        return pack_q0_32(I, K, r.J, r.D);
+    });
+    report_throughput("pack_q0_32_fast", [](uint32_t I, uint16_t K, const Q032Reciprocal &r) {
+        return pack_q0_32_fast(I, K, &r);
+    });
+}
+
+}  // namespace
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_tabulated_periods);
+    RUN_TEST(test_run_time_periods);
+    RUN_TEST(test_throughput);
+    return UNITY_END();
+}
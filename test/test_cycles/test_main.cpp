@@ -0,0 +1,147 @@
+/*
+ * test_main.cpp
+ *
+ * CLK_PER cycles of the conversion kernels and of the INL correction,
+ * counted by TCB0 on the MCU:
+ *     pio test -e Upload_UPDI -f test_cycles
+ * The firmware is not linked in, so TCB0 is free and no interrupt runs.
+ *
+ * Created: 10/16/2026
+ *  Author: uliano
+ */
+
+#include <avr/io.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unity.h>
+#include "arithmetic.h"
+#include "inl_correction.hpp"
+#include "window_length.hpp"
+
+namespace {
+
+struct CycleStats {
+    uint32_t total = 0;
+    uint16_t max = 0;
+    uint16_t count = 0;
+
+    void add(uint16_t cycles) {
+        total += cycles;
+        if (cycles > max) {
+            max = cycles;
+        }
+        ++count;
+    }
+};
+
+// TCB0 write-to-read latency, subtracted from every count.
+uint16_t g_overhead;
+
+volatile uint32_t g_sink;
+
+inline void timer_start(void) {
+    TCB0.CNT = 0;
+}
+
+inline uint16_t timer_read(void) {
+    return static_cast<uint16_t>(TCB0.CNT - g_overhead);
+}
+
+void report(const char *name, const CycleStats &stats) {
+    char message[64];
+    char number[12];
+    strcpy(message, name);
+    strcat(message, ": mean ");
+    ultoa(stats.total / stats.count, number, 10);
+    strcat(message, number);
+    strcat(message, ", max ");
+    ultoa(stats.max, number, 10);
+    strcat(message, number);
+    strcat(message, " cycles");
+    TEST_MESSAGE(message);
+}
+
+constexpr uint32_t bench_periods[] = {
+    window_period(WindowLength::PLC_0_02, GridFrequency::FREQ_50HZ),
+    window_period(WindowLength::PLC_1, GridFrequency::FREQ_50HZ),
+    window_period(WindowLength::PLC_100, GridFrequency::FREQ_60HZ),
+    window_period(WindowLength::PLC_200, GridFrequency::FREQ_50HZ)  // J * D above 2^32
+};
+
+constexpr uint16_t bench_frac_dens[] = {
+    Q0_32_FRAC_DEN_MIN, Q0_32_FRAC_DEN_NOMINAL, Q0_32_FRAC_DEN_MAX
+};
+
+// pack_q0_32() against pack_q0_32_fast() on the same inputs, results compared.
+void test_pack_q0_32_cycles(void) {
+    CycleStats exact, fast, reciprocal;
+    for (uint32_t J : bench_periods) {
+        for (uint16_t D : bench_frac_dens) {
+            Q032Reciprocal r;
+            timer_start();
+            q0_32_reciprocal(&r, J, D);
+            reciprocal.add(timer_read());
+            for (uint8_t step = 0; step < 16; ++step) {
+                const volatile uint32_t I = J / 16u * step + step;
+                const volatile uint16_t K = static_cast<uint16_t>(D / 16u * step);
+
+                timer_start();
+                const uint32_t x = pack_q0_32(I, K, J, D);
+                exact.add(timer_read());
+
+                timer_start();
+                const uint32_t y = pack_q0_32_fast(I, K, &r);
+                fast.add(timer_read());
+
+                TEST_ASSERT_EQUAL_HEX32(x, y);
+                g_sink = x;
+            }
+        }
+    }
+    report("pack_q0_32", exact);
+    report("pack_q0_32_fast", fast);
+    report("q0_32_reciprocal", reciprocal);
+}
+
+// InlCorrection::apply() on every segment, with a table of mixed signs.
+void test_inl_apply_cycles(void) {
+    InlCorrection inl;
+    InlTable table;
+    for (uint8_t i = 0; i < INL_NODES; ++i) {
+        table.node[i] = (i & 1 ? 1l : -1l) * (1000l * i + 17);
+    }
+    TEST_ASSERT_TRUE(inl.set_table(table));
+    inl.enable(true);
+    CycleStats stats;
+    for (uint8_t i = 0; i < INL_SEGMENTS; ++i) {
+        for (uint8_t step = 0; step < 8; ++step) {
+            const volatile uint32_t x = (static_cast<uint32_t>(i) << (32 - INL_SEGMENT_BITS)) +
+                                        static_cast<uint32_t>(step) * 0x01234567u;
+            timer_start();
+            const uint32_t y = inl.apply(x);
+            stats.add(timer_read());
+            g_sink = y;
+        }
+    }
+    report("InlCorrection::apply", stats);
+}
+
+}  // namespace
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    TCB0.CTRLA = TCB_CLKSEL_DIV1_gc | TCB_ENABLE_bm;  // CLK_PER, periodic interrupt mode
+    TCB0.CCMP = 0xFFFF;
+    timer_start();
+    g_overhead = TCB0.CNT;
+    RUN_TEST(test_pack_q0_32_cycles);
+    RUN_TEST(test_inl_apply_cycles);
+    return UNITY_END();
+}
@@ -0,0 +1,109 @@
+/*
+ * test_main.cpp
+ *
+ * wide_mul.h kernels against the plain C expressions they replace, bit for
+ * bit, on boundary and random operands.
+ *
+ * On the MCU (pio test -e Upload_UPDI -f test_wide_mul) this checks the asm
+ * against the libgcc 64-bit arithmetic; the host build (pio test -e native)
+ * compiles the C fallbacks and checks the reference itself.
+ *
+ * Created: 10/16/2026
+ *  Author: uliano
+ */
+
+#include <stdint.h>
+#include <unity.h>
+#include "wide_mul.h"
+
+namespace {
+
+#if defined(__AVR__)
+constexpr uint32_t RANDOM_CASES = 20000;
+#else
+constexpr uint32_t RANDOM_CASES = 2000000;
+#endif
+
+constexpr uint32_t boundary_operands[] = {
+    0u, 1u, 2u, 0x7Fu, 0x80u, 0xFFu, 0x100u, 0x7FFFu, 0x8000u, 0xFFFFu,
+    0x10000u, 0x00FF00FFu, 0xFF00FF00u, 0x55555555u, 0xAAAAAAAAu,
+    0x7FFFFFFFu, 0x80000000u, 0x80000001u, 0xFFFFFFFEu, 0xFFFFFFFFu
+};
+
+uint32_t g_random = 0x2545F491u;
+
+// xorshift32: same sequence on every build, so a failure can be replayed.
+uint32_t next_random(void) {
+    g_random ^= g_random << 13;
+    g_random ^= g_random >> 17;
+    g_random ^= g_random << 5;
+    return g_random;
+}
+
+void check_u32_u32(uint32_t a, uint32_t b) {
+    const uint64_t expected = (uint64_t)a * b;
+    const uint64_t actual = mul_u32_u32(a, b);
+    TEST_ASSERT_EQUAL_HEX32((uint32_t)(expected >> 32), (uint32_t)(actual >> 32));
+    TEST_ASSERT_EQUAL_HEX32((uint32_t)expected, (uint32_t)actual);
+}
+
+void check_u32_u16(uint32_t a, uint16_t b) {
+    const uint64_t expected = (uint64_t)a * b;
+    const uint64_t actual = mul_u32_u16(a, b);
+    TEST_ASSERT_EQUAL_HEX32((uint32_t)(expected >> 32), (uint32_t)(actual >> 32));
+    TEST_ASSERT_EQUAL_HEX32((uint32_t)expected, (uint32_t)actual);
+}
+
+void check_s32_u32(int32_t a, uint32_t b) {
+    const int32_t expected = (int32_t)(((int64_t)a * (int64_t)b) >> 32);
+    TEST_ASSERT_EQUAL_INT32(expected, mulhi_s32_u32(a, b));
+}
+
+void test_mul_u32_u32(void) {
+    for (uint32_t a : boundary_operands) {
+        for (uint32_t b : boundary_operands) {
+            check_u32_u32(a, b);
+        }
+    }
+    for (uint32_t n = 0; n < RANDOM_CASES; ++n) {
+        check_u32_u32(next_random(), next_random());
+    }
+}
+
+void test_mul_u32_u16(void) {
+    for (uint32_t a : boundary_operands) {
+        for (uint32_t b : boundary_operands) {
+            check_u32_u16(a, (uint16_t)b);
+        }
+    }
+    for (uint32_t n = 0; n < RANDOM_CASES; ++n) {
+        check_u32_u16(next_random(), (uint16_t)next_random());
+    }
+}
+
+void test_mulhi_s32_u32(void) {
+    for (uint32_t a : boundary_operands) {
+        for (uint32_t b : boundary_operands) {
+            check_s32_u32((int32_t)a, b);
+        }
+    }
+    for (uint32_t n = 0; n < RANDOM_CASES; ++n) {
+        check_s32_u32((int32_t)next_random(), next_random());
+    }
+}
+
+}  // namespace
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_mul_u32_u32);
+    RUN_TEST(test_mul_u32_u16);
+    RUN_TEST(test_mulhi_s32_u32);
+    return UNITY_END();
+}
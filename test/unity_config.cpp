@@ -0,0 +1,46 @@
+/*
+ * unity_config.cpp
+ *
+ * Created: 10/16/2026
+ *  Author: uliano
+ */
+
+#if defined(__AVR__)
+
+#include <avr/io.h>
+#include "unity_config.h"
+#include "clocks.h"
+
+constexpr uint32_t UNITY_BAUD = 115200;
+
+static bool g_unity_sending = false;  // TXCIF is only meaningful after a byte
+
+// Same clock and pins as the firmware (init_all(), Uart<2, UART_ALTERNATE>),
+// TX only and no interrupts.
+void unity_output_start(void) {
+    init_clocks();
+    PORTMUX.USARTROUTEA |= PORTMUX_USART2_0_bm;
+    PORTF.DIRSET = PIN4_bm;
+    PORTF.OUTSET = PIN4_bm;
+    USART2.BAUD = static_cast<uint16_t>((F_CPU * 4UL + UNITY_BAUD / 2UL) / UNITY_BAUD);
+    USART2.CTRLB = USART_TXEN_bm;
+}
+
+void unity_output_char(int c) {
+    while (!(USART2.STATUS & USART_DREIF_bm)) {
+    }
+    USART2.STATUS = USART_TXCIF_bm;
+    USART2.TXDATAL = static_cast<uint8_t>(c);
+    g_unity_sending = true;
+}
+
+void unity_output_flush(void) {
+    if (!g_unity_sending) {
+        return;
+    }
+    while (!(USART2.STATUS & USART_TXCIF_bm)) {
+    }
+    g_unity_sending = false;
+}
+
+#endif
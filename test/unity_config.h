@@ -0,0 +1,32 @@
+/*
+ * unity_config.h
+ *
+ * Unity output for the tests running on the MCU: polled USART2 on PF4/PF5,
+ * the SCPI port, at 115200. Host builds keep the Unity defaults (putchar).
+ *
+ * Created: 10/16/2026
+ *  Author: uliano
+ */
+
+#pragma once
+
+#if defined(__AVR__)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void unity_output_start(void);
+void unity_output_char(int c);
+void unity_output_flush(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define UNITY_OUTPUT_START()    unity_output_start()
+#define UNITY_OUTPUT_CHAR(c)    unity_output_char(c)
+#define UNITY_OUTPUT_FLUSH()    unity_output_flush()
+#define UNITY_OUTPUT_COMPLETE() unity_output_flush()
+
+#endif